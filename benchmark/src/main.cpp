@@ -0,0 +1,375 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+// ofMain.h normally provides these to the addon headers.
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "ofxDataBuffer.h"
+#include "ofxRandomSampler.h"
+
+
+// -----------------------------------------------------------------------------
+// allocation counting
+
+static std::atomic<size_t> allocationCount(0);
+
+// Every replacement below goes through these two out-of-line helpers.  If
+// the compiler inlined malloc / free into the operators it would see
+// operator new paired with free and warn (-Wmismatched-new-delete).
+#if defined(__GNUC__)
+#define BENCHMARK_NOINLINE __attribute__((noinline))
+#else
+#define BENCHMARK_NOINLINE
+#endif
+
+BENCHMARK_NOINLINE static void* countedAllocate(size_t size) {
+    allocationCount++;
+    if(void* p = malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+BENCHMARK_NOINLINE static void countedFree(void* p) noexcept {
+    free(p);
+}
+
+void* operator new(size_t size)                    { return countedAllocate(size); }
+void* operator new[](size_t size)                  { return countedAllocate(size); }
+void  operator delete(void* p) noexcept            { countedFree(p); }
+void  operator delete[](void* p) noexcept          { countedFree(p); }
+void  operator delete(void* p, size_t) noexcept    { countedFree(p); }
+void  operator delete[](void* p, size_t) noexcept  { countedFree(p); }
+
+
+// -----------------------------------------------------------------------------
+// harness
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result {
+    string benchmark;
+    string type;
+    size_t window;
+    string metric;
+    double value;
+
+    string key() const {
+        ostringstream ss;
+        ss << benchmark << "," << type << "," << window << "," << metric;
+        return ss.str();
+    }
+};
+
+static vector<Result> results;
+
+static void report(const string& benchmark, const string& type, size_t window, const string& metric, double value) {
+    Result r = { benchmark, type, window, metric, value };
+    results.push_back(r);
+    printf("%-24s %-7s %12zu %-14s %14.2f\n", benchmark.c_str(), type.c_str(), window, metric.c_str(), value);
+}
+
+static double elapsedNs(Clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static double percentile(vector<double>& samples, double p) {
+    size_t i = std::min(samples.size() - 1, (size_t)(p * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + i, samples.end());
+    return samples[i];
+}
+
+static void reportLatency(const string& benchmark, const string& type, size_t window, vector<double>& samples, size_t allocations) {
+    report(benchmark, type, window, "p50_ns",        percentile(samples, 0.50));
+    report(benchmark, type, window, "p90_ns",        percentile(samples, 0.90));
+    report(benchmark, type, window, "p99_ns",        percentile(samples, 0.99));
+    report(benchmark, type, window, "allocs_per_op", (double)allocations / samples.size());
+}
+
+// keeps the optimizer from discarding results
+static volatile double sink;
+
+template<typename T>
+static T sample(size_t i) {
+    return (T)((i * 2654435761u) % 1000) + 1;
+}
+
+
+// -----------------------------------------------------------------------------
+// ofxDataBuffer_
+
+template<typename T>
+static void benchmarkPushBack(const string& type, size_t window, bool pyramid) {
+    ofxDataBuffer_<T> buffer(window);
+    buffer.setPyramidEnabled(pyramid);
+
+    for(size_t i = 0; i < window; ++i) buffer.push_back(sample<T>(i));
+
+    // steady state: every push evicts
+    const size_t ops = 1 << 21;
+
+    size_t allocations = allocationCount;
+    Clock::time_point start = Clock::now();
+
+    for(size_t i = 0; i < ops; ++i) buffer.push_back(sample<T>(i));
+
+    double ns = elapsedNs(start);
+    allocations = allocationCount - allocations;
+
+    string name = pyramid ? "push_back_pyramid" : "push_back";
+    report(name, type, window, "ns_per_op",     ns / ops);
+    report(name, type, window, "allocs_per_op", (double)allocations / ops);
+}
+
+template<typename T>
+static void benchmarkQuery(const string& type, size_t window, bool median) {
+    ofxDataBuffer_<T> buffer(window);
+
+    for(size_t i = 0; i < window; ++i) buffer.push_back(sample<T>(i));
+
+    // enough iterations for stable percentiles without scanning 10^8 samples forever
+    size_t iterations = std::max<size_t>(5, std::min<size_t>(1000, (1 << 24) / window));
+
+    vector<double> latencies;
+    latencies.reserve(iterations);
+
+    size_t allocations = 0;
+
+    for(size_t i = 0; i < iterations; ++i) {
+        buffer.push_back(sample<T>(i)); // invalidates the cached stats
+
+        size_t before = allocationCount;
+        Clock::time_point start = Clock::now();
+
+        sink = median ? buffer.getMedian() : buffer.getMean();
+
+        latencies.push_back(elapsedNs(start));
+        allocations += allocationCount - before;
+    }
+
+    reportLatency(median ? "getMedian" : "calcStats", type, window, latencies, allocations);
+}
+
+template<typename T>
+static void benchmarkDataBuffer(const string& type, const vector<size_t>& windows) {
+    for(size_t i = 0; i < windows.size(); ++i) {
+        benchmarkPushBack<T>(type, windows[i], false);
+        benchmarkPushBack<T>(type, windows[i], true);
+        benchmarkQuery<T>(type, windows[i], false);
+        benchmarkQuery<T>(type, windows[i], true);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// ofxRandomSampler
+
+static void benchmarkSampler(const vector<size_t>& sizes) {
+    for(size_t s = 0; s < sizes.size(); ++s) {
+        size_t size = sizes[s];
+
+        ofxRandomSampler sampler(size);
+
+        // next() includes the amortized reshuffle every size draws
+        const size_t ops = 1 << 22;
+
+        size_t allocations = allocationCount;
+        Clock::time_point start = Clock::now();
+
+        size_t total = 0;
+        for(size_t i = 0; i < ops; ++i) total += sampler.next();
+        sink = total;
+
+        double ns = elapsedNs(start);
+        allocations = allocationCount - allocations;
+
+        report("sampler_next", "size_t", size, "ns_per_op",     ns / ops);
+        report("sampler_next", "size_t", size, "allocs_per_op", (double)allocations / ops);
+
+        size_t iterations = std::max<size_t>(5, std::min<size_t>(1000, (1 << 24) / size));
+
+        vector<double> latencies;
+        latencies.reserve(iterations);
+
+        allocations = allocationCount;
+
+        for(size_t i = 0; i < iterations; ++i) {
+            Clock::time_point resetStart = Clock::now();
+            sampler.reset();
+            latencies.push_back(elapsedNs(resetStart));
+        }
+
+        reportLatency("sampler_reset", "size_t", size, latencies, allocationCount - allocations);
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// baseline output and comparison
+
+static bool writeResults(const string& path) {
+    ofstream out(path.c_str());
+    if(!out) return false;
+
+    out << "benchmark,type,window,metric,value\n";
+    for(size_t i = 0; i < results.size(); ++i) {
+        out << results[i].key() << "," << results[i].value << "\n";
+    }
+    return out.good();
+}
+
+static bool readResults(const string& path, map<string, double>& values) {
+    ifstream in(path.c_str());
+    if(!in) return false;
+
+    string line;
+    getline(in, line); // header
+
+    while(getline(in, line)) {
+        size_t comma = line.rfind(',');
+        if(comma == string::npos) continue;
+        values[line.substr(0, comma)] = atof(line.substr(comma + 1).c_str());
+    }
+    return true;
+}
+
+// Every metric is lower-is-better.  Returns the number of regressions.
+static int compareResults(const map<string, double>& baseline, double threshold) {
+    int regressions = 0;
+
+    printf("\n%-60s %14s %14s %9s\n", "benchmark", "baseline", "current", "change");
+
+    for(size_t i = 0; i < results.size(); ++i) {
+        string key = results[i].key();
+        map<string, double>::const_iterator it = baseline.find(key);
+        if(it == baseline.end()) continue;
+
+        double before = it->second;
+        double after  = results[i].value;
+        double change = before > 0 ? (after - before) / before : (after > 0 ? 1.0 : 0.0);
+
+        // allocation counts are deterministic, any increase is a regression.
+        // tail percentiles are too noisy to gate on and are only shown.
+        const string& metric = results[i].metric;
+
+        bool regressed = false;
+        if(metric == "allocs_per_op") {
+            regressed = after > before + 1e-9;
+        } else if(metric == "ns_per_op" || metric == "p50_ns") {
+            regressed = change > threshold;
+        }
+
+        if(regressed) regressions++;
+
+        printf("%-60s %14.2f %14.2f %+8.1f%% %s\n",
+               key.c_str(), before, after, change * 100.0, regressed ? "REGRESSED" : "");
+    }
+
+    return regressions;
+}
+
+
+// -----------------------------------------------------------------------------
+
+static void usage() {
+    printf("usage: ofxMathUtilsBenchmark [options]\n"
+           "  --max-window N    largest window / sampler size (default 1000000, up to 100000000)\n"
+           "  --out FILE        write results as CSV, e.g. to refresh baseline.csv\n"
+           "  --compare FILE    compare against a baseline CSV; exits 1 on regression\n"
+           "  --threshold F     allowed relative slowdown of ns_per_op and p50_ns (default 0.25)\n");
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxWindow = 1000000;
+    string outPath;
+    string comparePath;
+    double threshold = 0.25;
+
+    for(int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+
+        if(arg == "--max-window" && hasValue) {
+            maxWindow = strtoull(argv[++i], NULL, 10);
+        } else if(arg == "--out" && hasValue) {
+            outPath = argv[++i];
+        } else if(arg == "--compare" && hasValue) {
+            comparePath = argv[++i];
+        } else if(arg == "--threshold" && hasValue) {
+            threshold = atof(argv[++i]);
+        } else {
+            usage();
+            return arg == "--help" ? 0 : 2;
+        }
+    }
+
+    map<string, double> baseline;
+    if(!comparePath.empty() && !readResults(comparePath, baseline)) {
+        fprintf(stderr, "could not read baseline %s\n", comparePath.c_str());
+        return 2;
+    }
+
+    const size_t sizes[] = { 64, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+
+    vector<size_t> windows;
+    for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && sizes[i] <= maxWindow; ++i) {
+        windows.push_back(sizes[i]);
+    }
+
+    printf("%-24s %-7s %12s %-14s %14s\n", "benchmark", "type", "window", "metric", "value");
+
+    benchmarkDataBuffer<float>("float", windows);
+    benchmarkDataBuffer<double>("double", windows);
+    benchmarkDataBuffer<int>("int", windows);
+
+    benchmarkSampler(windows);
+
+    if(!outPath.empty() && !writeResults(outPath)) {
+        fprintf(stderr, "could not write %s\n", outPath.c_str());
+        return 2;
+    }
+
+    if(!comparePath.empty()) {
+        int regressions = compareResults(baseline, threshold);
+        printf("\n%d regression(s)\n", regressions);
+        return regressions > 0 ? 1 : 0;
+    }
+
+    return 0;
+}
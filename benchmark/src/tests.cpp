@@ -0,0 +1,680 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+// Checks the aggregation pyramid against plain scans, round-trip and
+// corruption checks for the serialized and memory-mapped formats, the
+// counting instrumentation policy, and ofxStaticDataBuffer_.
+
+// ofMain.h normally provides these to the addon headers.
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "ofxDataBuffer.h"
+#include "ofxDataBufferCountingInstrumentation.h"
+#include "ofxMappedDataBuffer.h"
+#include "ofxStaticDataBuffer.h"
+
+
+static int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if(!(condition)) { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            failures++; \
+        } \
+    } while(0)
+
+
+// -----------------------------------------------------------------------------
+// ofxDataPyramid_
+
+// multiples of 1/8, so float sums are exact whatever order they're added in
+template<typename T>
+static T pyramidSample() {
+    int value = rand() % 2001 - 1000;
+    return numeric_limits<T>::is_integer ? (T)value : (T)(value / 8.0);
+}
+
+template<typename T>
+static void checkRange(ofxDataBuffer_<T>& pyramid, ofxDataBuffer_<T>& linear, size_t first, size_t last) {
+    CHECK(pyramid.getMin(first, last)  == linear.getMin(first, last));
+    CHECK(pyramid.getMax(first, last)  == linear.getMax(first, last));
+    CHECK(pyramid.getSum(first, last)  == linear.getSum(first, last));
+    CHECK(pyramid.getMean(first, last) == linear.getMean(first, last));
+}
+
+template<typename T>
+static void checkDecimated(ofxDataBuffer_<T>& buffer, size_t first, size_t last, size_t numBins) {
+    vector<T> minimums, maximums;
+    vector<double> means;
+    buffer.getDecimated(first, last, numBins, minimums, maximums, means);
+
+    const deque<T>& values = buffer.getBuffer();
+    size_t length = last - first;
+    size_t bins   = std::min(numBins, length);
+
+    CHECK(minimums.size() == bins && maximums.size() == bins && means.size() == bins);
+    if(minimums.size() != bins || maximums.size() != bins || means.size() != bins) return;
+
+    // every sample lands in exactly one bin
+    for(size_t i = 0; i < bins; ++i) {
+        size_t binFirst = first + (i * length) / bins;
+        size_t binLast  = first + ((i + 1) * length) / bins;
+
+        T      minimum = values[binFirst];
+        T      maximum = values[binFirst];
+        double sum     = 0.0;
+
+        for(size_t j = binFirst; j < binLast; ++j) {
+            minimum = std::min(minimum, values[j]);
+            maximum = std::max(maximum, values[j]);
+            sum += values[j];
+        }
+
+        CHECK(minimums[i] == minimum);
+        CHECK(maximums[i] == maximum);
+        CHECK(means[i] == sum / (binLast - binFirst));
+    }
+}
+
+template<typename T>
+static void testPyramid(size_t capacity) {
+    ofxDataBuffer_<T> pyramid(capacity);
+    ofxDataBuffer_<T> linear(capacity);
+
+    CHECK(pyramid.setPyramidEnabled(true));
+    srand(capacity);
+
+    // fill, wrap the ring a few times, then shrink and grow the window,
+    // each of which rebuilds the pyramid
+    const size_t steps   = 4 * capacity + 10;
+    const size_t shrink  = 2 * capacity;
+    const size_t grow    = 3 * capacity;
+
+    for(size_t step = 0; step < steps; ++step) {
+        if(step == shrink || step == grow) {
+            size_t size = step == shrink ? capacity / 2 + 1 : capacity;
+            pyramid.setMaxBufferSize(size);
+            linear.setMaxBufferSize(size);
+            CHECK(pyramid.isPyramidEnabled());
+        }
+
+        T value = pyramidSample<T>();
+        pyramid.push_back(value);
+        linear.push_back(value);
+
+        size_t size = linear.getSize();
+        checkRange(pyramid, linear, 0, size);
+
+        // random ranges, which straddle the ring's seam once it has wrapped
+        for(int q = 0; q < 2; ++q) {
+            size_t first = rand() % (size + 1);
+            size_t last  = rand() % (size + 1);
+            if(first > last) std::swap(first, last);
+            checkRange(pyramid, linear, first, last);
+        }
+
+        if(step % 97 == 0 && size > 0) {
+            size_t first   = rand() % size;
+            size_t last    = first + 1 + rand() % (size - first);
+            size_t numBins = 1 + rand() % (last - first + 3); // sometimes more bins than samples
+            checkDecimated(pyramid, first, last, numBins);
+            checkDecimated(linear,  first, last, numBins);
+        }
+    }
+}
+
+// random writes and erases straight to the pyramid, against a plain array
+template<typename T>
+static void testPyramidSlots(size_t capacity) {
+    ofxDataPyramid_<T> pyramid(capacity);
+    vector<T>    values(capacity);
+    vector<bool> occupied(capacity, false);
+
+    srand(capacity);
+
+    for(size_t step = 0; step < 20 * capacity; ++step) {
+        size_t slot = rand() % capacity;
+
+        if(rand() % 8 == 0) {
+            pyramid.erase(slot);
+            occupied[slot] = false;
+        } else {
+            values[slot]   = pyramidSample<T>();
+            occupied[slot] = true;
+            pyramid.set(slot, values[slot]);
+        }
+
+        size_t first = rand() % (capacity + 1);
+        size_t last  = rand() % (capacity + 1);
+        if(first > last) std::swap(first, last);
+        if(step % 2 == 0) { first = 0; last = capacity; }
+
+        typename ofxDataPyramid_<T>::Block block = pyramid.query(first, last);
+
+        size_t count = 0;
+        double sum   = 0.0;
+        T minimum = T(), maximum = T();
+
+        for(size_t i = first; i < last; ++i) {
+            if(!occupied[i]) continue;
+            if(count == 0 || values[i] < minimum) minimum = values[i];
+            if(count == 0 || values[i] > maximum) maximum = values[i];
+            sum += values[i];
+            count++;
+        }
+
+        CHECK(block.count == count);
+        CHECK(block.sum == sum);
+        if(count > 0) CHECK(block.minimum == minimum && block.maximum == maximum);
+    }
+}
+
+static void testPyramidCapacityLimits() {
+    const size_t sizes[] = { ((size_t)1 << 63) + 1, numeric_limits<size_t>::max() };
+
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        ofxDataPyramid_<int> pyramid(100);
+        CHECK(!pyramid.setCapacity(sizes[s]));
+        CHECK(pyramid.getCapacity() == 100);
+
+        // falls back to scanning instead of hanging or throwing
+        ofxIntDataBuffer huge(sizes[s]);
+        CHECK(!huge.setPyramidEnabled(true));
+        CHECK(!huge.isPyramidEnabled());
+        huge.push_back(3);
+        huge.push_back(5);
+        CHECK(huge.getMax(0, 2) == 5);
+
+        ofxIntDataBuffer resized(10);
+        CHECK(resized.setPyramidEnabled(true));
+        resized.setMaxBufferSize(sizes[s]);
+        CHECK(!resized.isPyramidEnabled());
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// ofxDataBufferSerializer
+
+typedef ofxDataBufferSerializer Serializer;
+
+// compares bit patterns, so NaN round-trips count as equal
+template<typename T>
+static bool sameSamples(const deque<T>& a, const deque<T>& b) {
+    if(a.size() != b.size()) return false;
+    for(size_t i = 0; i < a.size(); ++i) {
+        if(memcmp(&a[i], &b[i], sizeof(T)) != 0) return false;
+    }
+    return true;
+}
+
+template<typename T>
+static void fillSerializerFixture(ofxDataBuffer_<T>& buffer, size_t size) {
+    buffer.setMaxBufferSize(size);
+
+    const T extremes[] = {
+        numeric_limits<T>::max(),
+        numeric_limits<T>::min(),
+        numeric_limits<T>::is_integer ? numeric_limits<T>::min() : -numeric_limits<T>::max(),
+        numeric_limits<T>::quiet_NaN(),
+        numeric_limits<T>::infinity(),
+        T(0),
+        T(-1)
+    };
+
+    for(size_t i = 0; i < size; ++i) {
+        if(i % 97 < 7) {
+            buffer.push_back(extremes[i % 97]);
+        } else {
+            buffer.push_back((T)(sin(i * 0.01) * 100)); // smooth, so deltas and XORs stay small
+        }
+    }
+}
+
+template<typename T>
+static void testRoundTrip(Serializer::Compression compression) {
+    // empty, single sample, exactly one chunk, and several chunks
+    const size_t sizes[] = { 0, 1, Serializer::DEFAULT_CHUNK_SIZE, 3 * Serializer::DEFAULT_CHUNK_SIZE + 17 };
+
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        ofxDataBuffer_<T> original;
+        fillSerializerFixture(original, sizes[s]);
+
+        stringstream stream;
+        CHECK(original.writeTo(stream, compression));
+
+        ofxDataBuffer_<T> loaded(5);
+        loaded.setPyramidEnabled(true);
+        CHECK(loaded.readFrom(stream));
+        CHECK(loaded.getMaxBufferSize() == original.getMaxBufferSize());
+        CHECK(sameSamples(loaded.getBuffer(), original.getBuffer()));
+
+        if(sizes[s] > 1) CHECK(loaded.getMax(0, loaded.getSize()) == original.getMax());
+    }
+}
+
+static void testFdRoundTrip() {
+    const char* path = "ofxMathUtilsTests.serialized";
+
+    ofxDoubleDataBuffer original;
+    fillSerializerFixture(original, 10000);
+
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0644);
+    CHECK(fd >= 0);
+    CHECK(original.writeTo(fd, Serializer::COMPRESSION_XOR));
+    lseek(fd, 0, SEEK_SET);
+
+    ofxDoubleDataBuffer loaded;
+    CHECK(loaded.readFrom(fd));
+    CHECK(sameSamples(loaded.getBuffer(), original.getBuffer()));
+
+    close(fd);
+    unlink(path);
+}
+
+// a failed read must leave the previous window, and its pyramid, as they were
+template<typename T>
+static void checkRejected(const string& bytes) {
+    for(int pyramid = 0; pyramid < 2; ++pyramid) {
+        ofxDataBuffer_<T> buffer(3);
+        buffer.setPyramidEnabled(pyramid != 0);
+        buffer.push_back(1);
+        buffer.push_back(2);
+
+        stringstream stream(bytes);
+        CHECK(!buffer.readFrom(stream));
+        CHECK(buffer.getSize() == 2 && buffer.getMaxBufferSize() == 3);
+        CHECK(buffer.getFirst() == 1 && buffer.getLast() == 2);
+        CHECK(buffer.isPyramidEnabled() == (pyramid != 0));
+        CHECK(buffer.getMax(0, 2) == 2 && buffer.getSum(0, 2) == 3);
+    }
+}
+
+static void patchUint64(string& bytes, size_t offset, uint64_t value) {
+    for(int i = 0; i < 8; ++i) bytes[offset + i] = (char)(value >> (8 * i));
+}
+
+static void testSerializerCorruption() {
+    ofxIntDataBuffer original;
+    fillSerializerFixture(original, 2 * Serializer::DEFAULT_CHUNK_SIZE);
+
+    stringstream stream;
+    CHECK(original.writeTo(stream, Serializer::COMPRESSION_DELTA_VARINT));
+    const string valid = stream.str();
+
+    // truncated anywhere, including right before the end marker
+    const size_t cuts[] = { 0, 10, 31, 32, 33, 100, valid.size() / 2, valid.size() - 1 };
+    for(size_t i = 0; i < sizeof(cuts) / sizeof(cuts[0]); ++i) {
+        checkRejected<int>(valid.substr(0, cuts[i]));
+    }
+
+    string corrupt = valid;
+    corrupt[0] = 'X'; // magic
+    checkRejected<int>(corrupt);
+
+    corrupt = valid;
+    corrupt[10] = Serializer::COMPRESSION_XOR; // not valid for an integral type
+    checkRejected<int>(corrupt);
+
+    corrupt = valid;
+    corrupt[15] = 0x7F; // chunk size far past MAX_CHUNK_SIZE
+    checkRejected<int>(corrupt);
+
+    corrupt = valid;
+    corrupt[24]++; // header count disagrees with the chunks
+    checkRejected<int>(corrupt);
+
+    // implausible max buffer sizes, which a pyramid would otherwise try to
+    // allocate, or hang sizing
+    const uint64_t maxSizes[] = {
+        Serializer::MAX_BUFFER_SIZE + 1,
+        (uint64_t)1 << 40,
+        ((uint64_t)1 << 63) + 1,
+        numeric_limits<uint64_t>::max()
+    };
+    for(size_t i = 0; i < sizeof(maxSizes) / sizeof(maxSizes[0]); ++i) {
+        corrupt = valid;
+        patchUint64(corrupt, 16, maxSizes[i]);
+        checkRejected<int>(corrupt);
+    }
+
+    corrupt = valid;
+    patchUint64(corrupt, 16, original.getSize() - 1); // fewer slots than samples
+    patchUint64(corrupt, 24, original.getSize());
+    checkRejected<int>(corrupt);
+
+    // a large but plausible max size still loads, pyramid and all
+    ofxIntDataBuffer roomy(1 << 20);
+    roomy.push_back(7);
+    roomy.push_back(-7);
+    stringstream roomyStream;
+    CHECK(roomy.writeTo(roomyStream));
+
+    ofxIntDataBuffer loaded(3);
+    loaded.setPyramidEnabled(true);
+    CHECK(loaded.readFrom(roomyStream));
+    CHECK(loaded.getMaxBufferSize() == (1 << 20) && loaded.isPyramidEnabled());
+    CHECK(loaded.getMin(0, 2) == -7 && loaded.getMax(0, 2) == 7);
+
+    // and sizes a reader would reject aren't written in the first place
+    ofxIntDataBuffer unbounded(numeric_limits<size_t>::max());
+    stringstream unboundedStream;
+    CHECK(!unbounded.writeTo(unboundedStream));
+
+    checkRejected<float>(valid); // written as int
+}
+
+
+// -----------------------------------------------------------------------------
+// ofxMappedDataBuffer_
+
+static const char* MAPPED_PATH = "ofxMathUtilsTests.mapped";
+
+template<typename Field>
+static void patchMappedHeader(size_t offset, Field value) {
+    FILE* file = fopen(MAPPED_PATH, "r+b");
+    fseek(file, offset, SEEK_SET);
+    fwrite(&value, sizeof(value), 1, file);
+    fclose(file);
+}
+
+static void writeMappedFixture() {
+    unlink(MAPPED_PATH);
+
+    ofxMappedDoubleDataBuffer mapped;
+    CHECK(mapped.open(MAPPED_PATH, 100));
+    for(int i = 0; i < 250; i++) mapped.push_back((i * 37) % 101 - 50);
+    CHECK(mapped.getMean() != 0.0); // leaves cached stats in the header
+}
+
+static void testMappedReopen() {
+    writeMappedFixture();
+
+    ofxDoubleDataBuffer reference(100);
+    for(int i = 0; i < 250; i++) reference.push_back((i * 37) % 101 - 50);
+
+    {
+        ofxMappedDoubleDataBuffer mapped;
+        CHECK(mapped.open(MAPPED_PATH, 0));
+        CHECK(mapped.getMaxBufferSize() == 100);
+        CHECK(mapped.getSize() == reference.getSize());
+        CHECK(mapped.isStatsValid());
+
+        for(size_t i = 0; i < reference.getSize(); ++i) CHECK(mapped[i] == reference.getBuffer()[i]);
+
+        CHECK(mapped.getMin()    == reference.getMin());
+        CHECK(mapped.getMax()    == reference.getMax());
+        CHECK(mapped.getMean()   == reference.getMean());
+        CHECK(mapped.getStdDev() == reference.getStdDev());
+        CHECK(mapped.getMedian() == reference.getMedian());
+
+        // keeps going where the last process stopped
+        mapped.push_back(1000);
+        reference.push_back(1000);
+        CHECK(mapped.getLast() == 1000 && mapped.getFirst() == reference.getFirst());
+    }
+
+    {
+        ofxMappedDoubleDataBuffer reader;
+        CHECK(reader.open(MAPPED_PATH, 0, true));
+        CHECK(reader.isReadOnly());
+        CHECK(reader.getMax() == 1000);
+        CHECK(reader.getMean() == reference.getMean());
+    }
+
+    ofxMappedDoubleDataBuffer wrongCapacity;
+    CHECK(!wrongCapacity.open(MAPPED_PATH, 50));
+
+    ofxMappedDataBuffer_<long> wrongType; // same element size as double
+    CHECK(!wrongType.open(MAPPED_PATH, 0));
+
+    ofxMappedFloatDataBuffer wrongSize;
+    CHECK(!wrongSize.open(MAPPED_PATH, 0));
+}
+
+// a writer killed between storing the sample and the new tail
+static void testMappedCrashRecovery() {
+    ofxDoubleDataBuffer reference(100);
+    for(int i = 0; i < 250; i++) reference.push_back((i * 37) % 101 - 50);
+
+    writeMappedFixture();
+    patchMappedHeader<uint64_t>(offsetof(ofxMappedDataBufferHeader, tail), 1 << 30);
+
+    {
+        ofxMappedDoubleDataBuffer reader;
+        CHECK(reader.open(MAPPED_PATH, 0, true));
+        CHECK(reader.getSize() == 100 && reader.getLast() == reference.getLast());
+    }
+
+    ofxMappedDoubleDataBuffer mapped;
+    CHECK(mapped.open(MAPPED_PATH, 0));
+    CHECK(mapped.getSize() == 100);
+    CHECK(mapped.getHeader()->tail == mapped.getHeader()->head); // full
+
+    mapped.push_back(1000);
+    reference.push_back(1000);
+    CHECK(mapped.getLast() == 1000 && mapped.getFirst() == reference.getFirst());
+    CHECK(mapped.getMean() == reference.getMean());
+
+    mapped.close();
+    unlink(MAPPED_PATH);
+}
+
+static void testMappedCorruption() {
+    const size_t capacityOffset = offsetof(ofxMappedDataBufferHeader, capacity);
+    const size_t headOffset     = offsetof(ofxMappedDataBufferHeader, head);
+    const size_t countOffset    = offsetof(ofxMappedDataBufferHeader, count);
+
+    ofxMappedDoubleDataBuffer mapped;
+
+    writeMappedFixture();
+    patchMappedHeader<uint64_t>(headOffset, 100);
+    CHECK(!mapped.open(MAPPED_PATH, 0));
+
+    writeMappedFixture();
+    patchMappedHeader<uint64_t>(countOffset, 101);
+    CHECK(!mapped.open(MAPPED_PATH, 0));
+
+    writeMappedFixture();
+    patchMappedHeader<uint64_t>(capacityOffset, 0);
+    CHECK(!mapped.open(MAPPED_PATH, 0));
+
+    writeMappedFixture();
+    patchMappedHeader<uint64_t>(capacityOffset, (uint64_t)1 << 62); // would overflow capacity * sizeof(T)
+    CHECK(!mapped.open(MAPPED_PATH, 0));
+
+    writeMappedFixture();
+    CHECK(truncate(MAPPED_PATH, ofxMappedDoubleDataBuffer::DATA_OFFSET + 10 * sizeof(double)) == 0);
+    CHECK(!mapped.open(MAPPED_PATH, 0));
+
+    unlink(MAPPED_PATH);
+}
+
+
+// -----------------------------------------------------------------------------
+// ofxDataBufferCountingInstrumentation
+
+typedef ofxDataBuffer_<double, ofxDataBufferCountingInstrumentation> CountedBuffer;
+
+static CountedBuffer* publishedBuffer = NULL;
+static int publishedCount = 0;
+static bool publishedConsistent = true;
+
+static void checkPublished(const ofxDataBufferCounters& counters) {
+    publishedCount++;
+    // published once push_back() is done, so the eviction is already counted
+    if(counters.pushes - counters.evictions != publishedBuffer->getSize()) publishedConsistent = false;
+}
+
+static void testCountingInstrumentation() {
+    CountedBuffer buffer(10);
+    publishedBuffer = &buffer;
+    buffer.getInstrumentation().setCallback(checkPublished, 5);
+
+    for(int i = 0; i < 100; i++) buffer.push_back(i);
+
+    const ofxDataBufferCounters& counters = buffer.getInstrumentation().getCounters();
+    CHECK(counters.pushes == 100);
+    CHECK(counters.evictions == 90);
+    CHECK(publishedCount == 20);
+    CHECK(publishedConsistent);
+
+    buffer.getMean();
+    buffer.getMax();
+    CHECK(counters.recomputes == 1 && counters.cacheHits == 1);
+}
+
+
+// -----------------------------------------------------------------------------
+// ofxStaticDataBuffer_
+
+constexpr ofxStaticDataBuffer_<int, 4> staticFixture() {
+    ofxStaticDataBuffer_<int, 4> buffer;
+    for(int i = 1; i <= 6; i++) buffer.push_back(i * i % 7); // 1 4 2 2 4 1, keeps the last four
+    return buffer;
+}
+
+static_assert(staticFixture().isFull() && staticFixture().getSize() == 4);
+static_assert(staticFixture().getFirst() == 2 && staticFixture().getLast() == 1);
+static_assert(staticFixture().getMin() == 1 && staticFixture().getMinIndex() == 3);
+static_assert(staticFixture().getMax() == 4 && staticFixture().getMaxIndex() == 2);
+static_assert(staticFixture().getSum() == 9 && staticFixture().getMean() == 2.25);
+static_assert(staticFixture().getPopulationVariance() == 1.1875);
+
+// unselected statistics don't cost storage
+static_assert(sizeof(ofxStaticDataBuffer_<int, 4, ofxDataBufferStats::MIN | ofxDataBufferStats::MAX>)
+              < sizeof(ofxStaticDataBuffer_<int, 4>));
+
+static bool nearlyEqual(double a, double b) {
+    return fabs(a - b) <= 1e-12 * std::max(1.0, fabs(b));
+}
+
+template<size_t N>
+static void testStaticDataBuffer() {
+    ofxStaticDataBuffer_<int, N> buffer;
+    ofxIntDataBuffer reference(N);
+
+    srand(N);
+
+    for(int lap = 0; lap < 2; ++lap) {
+        // partly full, full, and wrapped a few times
+        for(size_t i = 0; i < 4 * N + 3; ++i) {
+            int value = rand() % 201 - 100;
+            buffer.push_back(value);
+            reference.push_back(value);
+
+            CHECK(buffer.getSize() == reference.getSize());
+            CHECK(buffer.getFirst() == reference.getFirst() && buffer.getLast() == reference.getLast());
+            CHECK(buffer.getMin() == reference.getMin() && buffer.getMax() == reference.getMax());
+            CHECK(buffer.getSum() == reference.getSum());
+            CHECK(buffer.getMedian() == reference.getMedian());
+
+            // the reference's mean and variance are running updates, a few ulps
+            // off, and its variance of one sample is 0 / 0
+            CHECK(nearlyEqual(buffer.getMean(), reference.getMean()));
+            if(buffer.getSize() > 1) CHECK(nearlyEqual(buffer.getVariance(), reference.getVariance()));
+        }
+
+        buffer.clear();
+        reference = ofxIntDataBuffer(N);
+    }
+}
+
+static void testStaticDataBufferSum() {
+    const size_t N = 16;
+    ofxStaticDataBuffer_<double, N, ofxDataBufferStats::SUM> buffer;
+
+    // mixed magnitudes, so a running sum alone would drift
+    for(size_t i = 0; i < 1000 * N; ++i) buffer.push_back(i % 3 == 0 ? 1e12 + i : 1e-3 * i);
+
+    double sum = 0.0;
+    for(size_t i = 0; i < N; ++i) sum += buffer[i];
+    CHECK(buffer.getSum() == sum); // at a lap boundary the sum is the window's
+
+    // a NaN stops counting by the end of the lap that evicts it
+    buffer.push_back(numeric_limits<double>::quiet_NaN());
+    CHECK(buffer.getSum() != buffer.getSum());
+    for(size_t i = 0; i < 2 * N - 1; ++i) buffer.push_back(1.0);
+    CHECK(buffer.getSum() == N);
+}
+
+
+// -----------------------------------------------------------------------------
+
+int main() {
+    // around and between the pyramid's leaf size and powers of two
+    const size_t capacities[] = { 1, 2, 5, 63, 64, 65, 100, 129, 1000, 4097 };
+    for(size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]); ++i) {
+        testPyramid<int>(capacities[i]);
+        testPyramid<float>(capacities[i]);
+        testPyramidSlots<int>(capacities[i]);
+        testPyramidSlots<float>(capacities[i]);
+    }
+    testPyramidCapacityLimits();
+
+    testRoundTrip<double>(Serializer::COMPRESSION_NONE);
+    testRoundTrip<double>(Serializer::COMPRESSION_XOR);
+    testRoundTrip<float>(Serializer::COMPRESSION_NONE);
+    testRoundTrip<float>(Serializer::COMPRESSION_XOR);
+    testRoundTrip<int>(Serializer::COMPRESSION_NONE);
+    testRoundTrip<int>(Serializer::COMPRESSION_DELTA_VARINT);
+    testRoundTrip<long>(Serializer::COMPRESSION_DELTA_VARINT);
+    testRoundTrip<char>(Serializer::COMPRESSION_DELTA_VARINT);
+    testFdRoundTrip();
+    testSerializerCorruption();
+
+    testMappedReopen();
+    testMappedCrashRecovery();
+    testMappedCorruption();
+
+    testCountingInstrumentation();
+
+    testStaticDataBuffer<7>();
+    testStaticDataBuffer<8>();
+    testStaticDataBufferSum();
+
+    if(failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    printf("all checks passed\n");
+    return 0;
+}
@@ -27,8 +27,15 @@
 #include <vector>
 #include <set>
 
-template<typename T>
-class ofxDataBuffer_ {
+#include "ofxDataStatistics.h"
+#include "ofxDataPyramid.h"
+#include "ofxDataBufferSerializer.h"
+#include "ofxDataBufferInstrumentation.h"
+
+// Instrumentation is a compile-time policy, see ofxDataBufferInstrumentation.h.
+// The default records nothing and costs nothing.
+template<typename T, typename Instrumentation = ofxDataBufferNoInstrumentation>
+class ofxDataBuffer_: private Instrumentation {
 public:
     ofxDataBuffer_();
     ofxDataBuffer_(size_t maxSize);
@@ -46,6 +53,8 @@ public:
     
     size_t getSize();
     
+    const deque<T>& getBuffer() const;
+    
     // buffer statistics
     void calcStats();
     bool statsValid;
@@ -71,296 +80,513 @@ public:
     
     double getMedian();
     
-private:
-
-    double sum;
-    double product;
-    double variance;
-    double variancePopulation;
+    // range statistics over [first, last) are answered from an aggregation
+    // pyramid in O(log n) plus up to two partial leaves when enabled,
+    // otherwise by scanning the buffer.  The pyramid is sized for the max
+    // buffer size up front, at about sizeof(T) + 2 bytes per sample (see
+    // ofxDataPyramid_).  Enabling it returns false when it can't be sized,
+    // and setMaxBufferSize() turns it off in that case.
+    bool   setPyramidEnabled(bool enabled);
+    bool   isPyramidEnabled() const;
+    
+    T      getMin(size_t first, size_t last);
+    T      getMax(size_t first, size_t last);
+    double getSum(size_t first, size_t last);
+    double getMean(size_t first, size_t last);
+    
+    // reduce [first, last) to numBins min / max / mean triples for plotting
+    void   getDecimated(size_t first,
+                        size_t last,
+                        size_t numBins,
+                        vector<T>& minimums,
+                        vector<T>& maximums,
+                        vector<double>& means);
+    
+    // binary snapshots, see ofxDataBufferSerializer for the format.  Reading
+    // replaces the contents and max buffer size with those in the stream, and
+    // leaves the buffer untouched if the stream is malformed or truncated, or
+    // if allocating for it throws.  Max buffer sizes above
+    // ofxDataBufferSerializer::MAX_BUFFER_SIZE can't be written.
+    bool   writeTo(ostream& stream,
+                   ofxDataBufferSerializer::Compression compression = ofxDataBufferSerializer::COMPRESSION_NONE);
+    bool   writeTo(int fd,
+                   ofxDataBufferSerializer::Compression compression = ofxDataBufferSerializer::COMPRESSION_NONE);
+    bool   readFrom(istream& stream);
+    bool   readFrom(int fd);
+    
+    Instrumentation& getInstrumentation();
     
-    double mean;
-    double harmMean;
-    double geoMean;
-    double stdDev;
-    double stdDevPopulation;
+private:
+    typedef typename Instrumentation::ScopedTimer ScopedTimer;
     
-    T minimum;
-    size_t minimumIdx;
-    T maximum;
-    size_t maximumIdx;
+    template<typename Sink>
+    bool write(Sink& sink, ofxDataBufferSerializer::Compression compression);
+    template<typename Source>
+    bool read(Source& source);
     
+    typename ofxDataPyramid_<T>::Block getRange(size_t first, size_t last);
+    bool rebuildPyramid();
+    bool fillPyramid(ofxDataPyramid_<T>& target, const deque<T>& values, size_t capacity);
+
+    ofxDataStatistics stats;
     
     deque<T> buffer;
     size_t maxSize;
     
+    bool   pyramidEnabled;
+    size_t pyramidHead; // pyramid slot holding buffer[0]
+    ofxDataPyramid_<T> pyramid;
+    
 };
 
-template<typename T>
-ofxDataBuffer_<T>::ofxDataBuffer_(){
+template<typename T, typename Instrumentation>
+ofxDataBuffer_<T, Instrumentation>::ofxDataBuffer_(){
     maxSize        = 1;
     statsValid     = false;
+    pyramidEnabled = false;
+    pyramidHead    = 0;
 }
 
-template<typename T>
-ofxDataBuffer_<T>::ofxDataBuffer_(size_t _maxSize){
+template<typename T, typename Instrumentation>
+ofxDataBuffer_<T, Instrumentation>::ofxDataBuffer_(size_t _maxSize){
     maxSize        = _maxSize;
     statsValid     = false;
+    pyramidEnabled = false;
+    pyramidHead    = 0;
 }
 
-template<typename T>
-ofxDataBuffer_<T>::ofxDataBuffer_(const vector<T>& data){
+template<typename T, typename Instrumentation>
+ofxDataBuffer_<T, Instrumentation>::ofxDataBuffer_(const vector<T>& data){
     maxSize        = data.size();
     statsValid     = false;
+    pyramidEnabled = false;
+    pyramidHead    = 0;
     push_back(data,true);
 }
 
-template<typename T>
-ofxDataBuffer_<T>::ofxDataBuffer_(T* data, int length){
+template<typename T, typename Instrumentation>
+ofxDataBuffer_<T, Instrumentation>::ofxDataBuffer_(T* data, int length){
     maxSize        = length;
     statsValid     = false;
+    pyramidEnabled = false;
+    pyramidHead    = 0;
     push_back(data,length,true);
 }
 
-template<typename T>
-ofxDataBuffer_<T>::~ofxDataBuffer_(){}
+template<typename T, typename Instrumentation>
+ofxDataBuffer_<T, Instrumentation>::~ofxDataBuffer_(){}
 
 
-template<typename T>
-deque<T>& ofxDataBuffer_<T>::getBuffer(){
+template<typename T, typename Instrumentation>
+const deque<T>& ofxDataBuffer_<T, Instrumentation>::getBuffer() const {
     return buffer;
 }
 
-template<typename T>
-void ofxDataBuffer_<T>::calcStats(){
+template<typename T, typename Instrumentation>
+void ofxDataBuffer_<T, Instrumentation>::calcStats(){
     
     if(statsValid) {
+        this->onCacheHit();
         return;
     } else {
         statsValid = true;
     }
     
-    sum         = 0.0;
-    product     = 0.0;
-    variance    = 0.0;
-    mean        = 0.0;
-    harmMean    = 0.0;
-    geoMean     = 0.0;
-    stdDev      = 0.0;
-    minimum     = 0.0;
-    maximum     = 0.0;
-
-    minimumIdx  = 0;
-    maximumIdx  = 0;
-    
-    if(buffer.empty()) return;
-    
-    bool hasNegativeValues = false;
-    
-    int    n      = 0;
-    double delta  = 0.0;
-    double M2     = 0.0;
-    double invSum = 0.0;
+    this->onRecompute();
+    ScopedTimer timer(*this, ofxDataBufferCounters::TIME_CALC_STATS);
     
-    for(size_t i = 0; i < buffer.size(); ++i) {
-        T         value = buffer[i];
-        double invValue = 1.0 / value;
-        if(value < 0) hasNegativeValues = true;
-
-        n = n+1;
-        
-        if(i == 0) {
-            sum       = value;
-            product   = value;
-            invSum    = invValue;
-            minimum   = value;
-            maximum   = value;
-            minimumIdx  = 0;
-            maximumIdx  = 0;
-
-        } else {
-            sum      += value;
-            product  *= value;
-            invSum   += invValue;
-            
-            if(value < minimum) {
-                minimum    = value;
-                minimumIdx = i;
-            }
-            
-            if(value > maximum) {
-                maximum    = value;
-                maximumIdx = i;
-            }
-        }
-
-        
-        delta = value - mean;
-        mean  = mean + delta/n;
-        M2    = M2 + delta * (value - mean);
-
-    }
-    
-    harmMean           = hasNegativeValues ? -1 : (n / invSum);
-    geoMean            = hasNegativeValues ? -1 : pow(product, 1.0 / n);
-
-    variancePopulation = M2 / (n);
-    variance           = M2 / (n - 1);
-
-    stdDevPopulation   = sqrt(variancePopulation);
-    stdDev             = sqrt(variance);
+    ofxCalcStatistics<T>(buffer, buffer.size(), stats);
 }
 
-template<typename T>
-void ofxDataBuffer_<T>::push_back(const T& data, bool expand){
+template<typename T, typename Instrumentation>
+void ofxDataBuffer_<T, Instrumentation>::push_back(const T& data, bool expand){
     
     buffer.push_back(data); // buffer it
+    this->onPush();
 
+    bool evicted = false;
+    
     if(buffer.size() > maxSize) {
         buffer.erase(buffer.begin()); // remove the last one
+        this->onEvict(1);
+        evicted = true;
+    }
+    
+    if(pyramidEnabled && maxSize > 0) {
+        // the new value reuses the slot of the evicted one
+        if(evicted) pyramidHead = (pyramidHead + 1) % maxSize;
+        pyramid.set((pyramidHead + buffer.size() - 1) % maxSize, data);
     }
     
     statsValid = false;
+    
+    this->onPushComplete();
 }
 
-template<typename T>
-void ofxDataBuffer_<T>::push_back(const vector<T>& data, bool expand) {
+template<typename T, typename Instrumentation>
+void ofxDataBuffer_<T, Instrumentation>::push_back(const vector<T>& data, bool expand) {
     for(int i = 0; i < (int)data.size(); i++) push_back(data[i], expand);
 }
 
 
-template<typename T>
-void ofxDataBuffer_<T>::push_back(T* data, int length, bool expand) {
+template<typename T, typename Instrumentation>
+void ofxDataBuffer_<T, Instrumentation>::push_back(T* data, int length, bool expand) {
     for(int i = 0; i < length; i++) push_back(data[i], expand);
 }
 
-template<typename T>
-void ofxDataBuffer_<T>::setMaxBufferSize(size_t _maxSize) {
+template<typename T, typename Instrumentation>
+void ofxDataBuffer_<T, Instrumentation>::setMaxBufferSize(size_t _maxSize) {
     maxSize = _maxSize;
 
     // will remove values on next
     while(buffer.size() > maxSize) {
         buffer.erase(buffer.begin()); // remove the last one
+        this->onEvict(1);
         statsValid = false;
     }
+    
+    if(pyramidEnabled) rebuildPyramid();
 }
 
-template<typename T>
-size_t ofxDataBuffer_<T>::getMaxBufferSize() {
+template<typename T, typename Instrumentation>
+size_t ofxDataBuffer_<T, Instrumentation>::getMaxBufferSize() {
     return maxSize;
 }
 
-template<typename T>
-size_t ofxDataBuffer_<T>::getSize() {
+template<typename T, typename Instrumentation>
+size_t ofxDataBuffer_<T, Instrumentation>::getSize() {
     return buffer.size();
 }
 
 
-template<typename T>
-T ofxDataBuffer_<T>::getLast(){
+template<typename T, typename Instrumentation>
+T ofxDataBuffer_<T, Instrumentation>::getLast(){
     return buffer[getSize()-1];
 }
 
-template<typename T>
-T ofxDataBuffer_<T>::getFirst(){
+template<typename T, typename Instrumentation>
+T ofxDataBuffer_<T, Instrumentation>::getFirst(){
     return buffer[0];
 }
 
-template<typename T>
-T ofxDataBuffer_<T>::getMin(){
+template<typename T, typename Instrumentation>
+T ofxDataBuffer_<T, Instrumentation>::getMin(){
     calcStats();
-    return minimum;
+    return buffer.empty() ? T() : buffer[stats.minimumIdx];
 }
 
-template<typename T>
-T ofxDataBuffer_<T>::getMax(){
+template<typename T, typename Instrumentation>
+T ofxDataBuffer_<T, Instrumentation>::getMax(){
     calcStats();
-    return maximum;
+    return buffer.empty() ? T() : buffer[stats.maximumIdx];
 }
 
-template<typename T>
-size_t ofxDataBuffer_<T>::getMinIndex(){
+template<typename T, typename Instrumentation>
+size_t ofxDataBuffer_<T, Instrumentation>::getMinIndex(){
     calcStats();
-    return minimumIdx;
+    return stats.minimumIdx;
 }
 
-template<typename T>
-size_t ofxDataBuffer_<T>::getMaxIndex(){
+template<typename T, typename Instrumentation>
+size_t ofxDataBuffer_<T, Instrumentation>::getMaxIndex(){
     calcStats();
-    return maximumIdx;
+    return stats.maximumIdx;
 }
 
 
-template<typename T>
-double ofxDataBuffer_<T>::getSum(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getSum(){
     calcStats();
-    return sum;
+    return stats.sum;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getProduct(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getProduct(){
     calcStats();
-    return product;
+    return stats.product;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getMean(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getMean(){
     calcStats();
-    return mean;
+    return stats.mean;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getHarmonicMean(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getHarmonicMean(){
     calcStats();
-    return harmMean;
+    return stats.harmMean;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getGeometricMean(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getGeometricMean(){
     calcStats();
-    return geoMean;
+    return stats.geoMean;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getMedian(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getMedian(){
     // median is not cached
-     
-    deque<T> bufferCopy = buffer;
-    size_t size = bufferCopy.size();
-    int    n    = size / 2;
-
-    std::nth_element(bufferCopy.begin(), bufferCopy.begin()+n, bufferCopy.end());
-    double med = bufferCopy[n];
-    
-    if(size % 2 != 0) { // odd
-        return med;
-    } else { // even
-        std::nth_element(bufferCopy.begin(), bufferCopy.begin()+(n - 1), bufferCopy.end());
-        return (med + bufferCopy[n - 1]) / 2.0;
+    ScopedTimer timer(*this, ofxDataBufferCounters::TIME_MEDIAN);
+    this->onMedianCopy(buffer.size() * sizeof(T));
+    
+    return ofxCalcMedian<T>(buffer, buffer.size());
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::setPyramidEnabled(bool enabled){
+    if(enabled == pyramidEnabled) return true;
+    
+    if(enabled) return rebuildPyramid();
+    
+    pyramidEnabled = false;
+    pyramidHead    = 0;
+    pyramid.setCapacity(0); // release the blocks
+    return true;
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::isPyramidEnabled() const {
+    return pyramidEnabled;
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::rebuildPyramid(){
+    // release the old blocks first; the pyramid stays off if the new ones
+    // can't be sized or allocated
+    pyramidEnabled = false;
+    pyramidHead    = 0;
+    pyramid.setCapacity(0);
+    
+    pyramidEnabled = fillPyramid(pyramid, buffer, maxSize);
+    return pyramidEnabled;
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::fillPyramid(ofxDataPyramid_<T>& target, const deque<T>& values, size_t capacity){
+    if(!target.setCapacity(capacity)) return false;
+    this->onAllocate(target.getNumBytes());
+    
+    for(size_t i = 0; i < values.size(); ++i) {
+        target.set(i, values[i]);
     }
+    
+    return true;
+}
+
+template<typename T, typename Instrumentation>
+typename ofxDataPyramid_<T>::Block ofxDataBuffer_<T, Instrumentation>::getRange(size_t first, size_t last){
+    ScopedTimer timer(*this, ofxDataBufferCounters::TIME_RANGE);
+    
+    typename ofxDataPyramid_<T>::Block result = ofxDataPyramid_<T>::emptyBlock();
+    
+    if(last > buffer.size()) last = buffer.size();
+    if(first >= last) return result;
+    
+    if(pyramidEnabled) {
+        // a logical range maps to at most two physical runs of the ring
+        size_t start = (pyramidHead + first) % maxSize;
+        size_t end   = start + (last - first);
+        
+        if(end <= maxSize) {
+            result = pyramid.query(start, end);
+        } else {
+            result = ofxDataPyramid_<T>::combine(pyramid.query(start, maxSize),
+                                                 pyramid.query(0, end - maxSize));
+        }
+    } else {
+        result.minimum = buffer[first];
+        result.maximum = buffer[first];
+        result.count   = last - first;
+        
+        for(size_t i = first; i < last; ++i) {
+            T value = buffer[i];
+            if(value < result.minimum) result.minimum = value;
+            if(value > result.maximum) result.maximum = value;
+            result.sum += value;
+        }
+    }
+    
+    return result;
+}
+
+template<typename T, typename Instrumentation>
+T ofxDataBuffer_<T, Instrumentation>::getMin(size_t first, size_t last){
+    return getRange(first, last).minimum;
+}
+
+template<typename T, typename Instrumentation>
+T ofxDataBuffer_<T, Instrumentation>::getMax(size_t first, size_t last){
+    return getRange(first, last).maximum;
+}
+
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getSum(size_t first, size_t last){
+    return getRange(first, last).sum;
+}
+
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getMean(size_t first, size_t last){
+    typename ofxDataPyramid_<T>::Block range = getRange(first, last);
+    return range.count > 0 ? range.sum / range.count : 0.0;
+}
+
+template<typename T, typename Instrumentation>
+void ofxDataBuffer_<T, Instrumentation>::getDecimated(size_t first,
+                                                      size_t last,
+                                                      size_t numBins,
+                                                      vector<T>& minimums,
+                                                      vector<T>& maximums,
+                                                      vector<double>& means){
+    minimums.clear();
+    maximums.clear();
+    means.clear();
+    
+    if(last > buffer.size()) last = buffer.size();
+    if(first >= last || numBins == 0) return;
+    
+    size_t length = last - first;
+    if(numBins > length) numBins = length;
+    
+    minimums.reserve(numBins);
+    maximums.reserve(numBins);
+    means.reserve(numBins);
+    
+    for(size_t i = 0; i < numBins; ++i) {
+        size_t binFirst = first + (i * length) / numBins;
+        size_t binLast  = first + ((i + 1) * length) / numBins;
+        
+        typename ofxDataPyramid_<T>::Block bin = getRange(binFirst, binLast);
+        
+        minimums.push_back(bin.minimum);
+        maximums.push_back(bin.maximum);
+        means.push_back(bin.sum / bin.count);
+    }
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::writeTo(ostream& stream, ofxDataBufferSerializer::Compression compression){
+    ofxDataBufferSerializer::StreamSink sink(stream);
+    return write(sink, compression);
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::writeTo(int fd, ofxDataBufferSerializer::Compression compression){
+    ofxDataBufferSerializer::FdSink sink(fd);
+    return write(sink, compression);
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::readFrom(istream& stream){
+    ofxDataBufferSerializer::StreamSource source(stream);
+    return read(source);
+}
+
+template<typename T, typename Instrumentation>
+bool ofxDataBuffer_<T, Instrumentation>::readFrom(int fd){
+    ofxDataBufferSerializer::FdSource source(fd);
+    return read(source);
+}
+
+template<typename T, typename Instrumentation>
+template<typename Sink>
+bool ofxDataBuffer_<T, Instrumentation>::write(Sink& sink, ofxDataBufferSerializer::Compression compression){
+    if(!ofxDataBufferSerializer::supports<T>(compression)) return false;
+    
+    ofxDataBufferSerializer::Header header =
+        ofxDataBufferSerializer::makeHeader<T>(compression, maxSize, buffer.size());
+    
+    if(!ofxDataBufferSerializer::writeHeader(sink, header)) return false;
+    
+    vector<T>       chunk;
+    vector<uint8_t> scratch;
+    
+    chunk.reserve(header.chunkSize);
+    
+    for(size_t i = 0; i < buffer.size(); i += header.chunkSize) {
+        size_t end = std::min(buffer.size(), i + header.chunkSize);
+        chunk.assign(buffer.begin() + i, buffer.begin() + end);
+        
+        if(!ofxDataBufferSerializer::writeChunk(sink, header, &chunk[0], chunk.size(), scratch)) {
+            return false;
+        }
+    }
+    
+    return ofxDataBufferSerializer::writeEnd(sink);
+}
+
+template<typename T, typename Instrumentation>
+template<typename Source>
+bool ofxDataBuffer_<T, Instrumentation>::read(Source& source){
+    ofxDataBufferSerializer::Header header;
+    
+    if(!ofxDataBufferSerializer::readHeader(source, header)
+       || header.typeCode != ofxDataBufferSerializer::getTypeCode<T>()
+       || !ofxDataBufferSerializer::supports<T>(header.compression)) {
+        return false;
+    }
+    
+    // decode on the side so a bad stream leaves the current window alone
+    deque<T>        loaded;
+    vector<T>       chunk;
+    vector<uint8_t> scratch;
+    uint64_t        count = 0;
+    
+    do {
+        if(!ofxDataBufferSerializer::readChunk(source, header, chunk, scratch)) return false;
+        
+        count += chunk.size();
+        if(count > header.count) return false; // never holds more than the header promised
+        
+        loaded.insert(loaded.end(), chunk.begin(), chunk.end());
+    } while(!chunk.empty());
+    
+    if(count != header.count) return false;
+    
+    // size the new pyramid before replacing anything, so a max size it
+    // can't be built for, or a bad_alloc, leaves the buffer as it was
+    ofxDataPyramid_<T> loadedPyramid;
+    if(pyramidEnabled && !fillPyramid(loadedPyramid, loaded, header.maxSize)) return false;
+    
+    buffer.swap(loaded);
+    maxSize    = header.maxSize;
+    statsValid = false;
+    
+    if(pyramidEnabled) {
+        pyramid.swap(loadedPyramid);
+        pyramidHead = 0;
+    }
+    
+    return true;
+}
+
+template<typename T, typename Instrumentation>
+Instrumentation& ofxDataBuffer_<T, Instrumentation>::getInstrumentation(){
+    return *this;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getVariance(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getVariance(){
     calcStats();
-    return variance;
+    return stats.variance;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getStdDev(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getStdDev(){
     calcStats();
-    return stdDev;
+    return stats.stdDev;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getPopulationVariance(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getPopulationVariance(){
     calcStats();
-    return variancePopulation;
+    return stats.variancePopulation;
 }
 
-template<typename T>
-double ofxDataBuffer_<T>::getPopulationStdDev(){
+template<typename T, typename Instrumentation>
+double ofxDataBuffer_<T, Instrumentation>::getPopulationStdDev(){
     calcStats();
-    return stdDevPopulation;
+    return stats.stdDevPopulation;
 }
 
 typedef ofxDataBuffer_<char>   ofxCharDataBuffer;
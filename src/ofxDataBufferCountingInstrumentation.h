@@ -0,0 +1,121 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+
+#include "ofxDataBufferInstrumentation.h"
+
+// Counts hot-path events and time spent per statistic.  Requires C++11.
+//
+//   ofxDataBuffer_<double, ofxDataBufferCountingInstrumentation> buffer(1024);
+//   ...
+//   const ofxDataBufferCounters& c = buffer.getInstrumentation().getCounters();
+class ofxDataBufferCountingInstrumentation {
+public:
+    typedef std::function<void(const ofxDataBufferCounters&)> Callback;
+
+    class ScopedTimer {
+    public:
+        ScopedTimer(ofxDataBufferCountingInstrumentation& _owner, ofxDataBufferCounters::Timer _timer):
+            owner(_owner),
+            timer(_timer),
+            start(std::chrono::steady_clock::now())
+        {
+        }
+
+        ~ScopedTimer() {
+            owner.counters.nanos[timer] += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        }
+
+    private:
+        ofxDataBufferCountingInstrumentation& owner;
+        ofxDataBufferCounters::Timer timer;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    ofxDataBufferCountingInstrumentation():
+        pushInterval(0)
+    {
+        resetCounters();
+    }
+
+    const ofxDataBufferCounters& getCounters() const {
+        return counters;
+    }
+
+    void resetCounters() {
+        memset(&counters, 0, sizeof(counters));
+    }
+
+    // Calls callback with the counters every pushInterval pushes, or only
+    // from publishCounters() when pushInterval is 0.
+    void setCallback(Callback _callback, uint64_t _pushInterval = 0) {
+        callback     = _callback;
+        pushInterval = _pushInterval;
+    }
+
+    void publishCounters() {
+        if(callback) callback(counters);
+    }
+
+    void onPush() {
+        counters.pushes++;
+    }
+
+    void onEvict(size_t n) {
+        counters.evictions += n;
+    }
+
+    void onPushComplete() {
+        if(pushInterval > 0 && counters.pushes % pushInterval == 0) publishCounters();
+    }
+
+    void onRecompute() {
+        counters.recomputes++;
+    }
+
+    void onCacheHit() {
+        counters.cacheHits++;
+    }
+
+    void onMedianCopy(size_t bytes) {
+        counters.medianCopies++;
+        counters.bytesAllocated += bytes;
+    }
+
+    void onAllocate(size_t bytes) {
+        counters.bytesAllocated += bytes;
+    }
+
+private:
+    ofxDataBufferCounters counters;
+
+    Callback callback;
+    uint64_t pushInterval;
+
+};
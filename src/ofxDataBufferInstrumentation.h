@@ -0,0 +1,76 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Instrumentation policies for ofxDataBuffer_.  The buffer calls the hooks
+// below on its hot paths; ofxDataBufferNoInstrumentation (the default)
+// implements them as empty inline functions, so they compile away.
+//
+// A policy provides:
+//   onPush(), onEvict(n), onPushComplete(), onRecompute(), onCacheHit(),
+//   onMedianCopy(bytes), onAllocate(bytes)
+//   ScopedTimer(policy, ofxDataBufferCounters::Timer) timing its own scope
+//
+// onPushComplete() runs once push_back() has finished evicting and updating
+// the pyramid, so the buffer and the counters are consistent there.
+//
+// This header has no dependencies beyond <stdint.h>.  The counting policy,
+// which needs C++11, lives in ofxDataBufferCountingInstrumentation.h.
+
+struct ofxDataBufferCounters {
+    enum Timer {
+        TIME_CALC_STATS = 0,
+        TIME_MEDIAN,
+        TIME_RANGE,     // range statistics and getDecimated()
+        NUM_TIMERS
+    };
+
+    uint64_t pushes;
+    uint64_t evictions;
+    uint64_t recomputes;     // calcStats() full passes
+    uint64_t cacheHits;      // calcStats() calls answered from the cache
+    uint64_t medianCopies;
+    uint64_t bytesAllocated; // by the buffer itself, not by its std::deque
+    uint64_t nanos[NUM_TIMERS];
+};
+
+class ofxDataBufferNoInstrumentation {
+public:
+    class ScopedTimer {
+    public:
+        ScopedTimer(ofxDataBufferNoInstrumentation&, ofxDataBufferCounters::Timer) { }
+    };
+
+    void onPush() { }
+    void onEvict(size_t) { }
+    void onPushComplete() { }
+    void onRecompute() { }
+    void onCacheHit() { }
+    void onMedianCopy(size_t) { }
+    void onAllocate(size_t) { }
+};
@@ -0,0 +1,517 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <istream>
+#include <ostream>
+#include <cerrno>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(TARGET_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// A chunked binary format for streams of samples.
+//
+//   header:  "OFXDBSER", version, type code, compression, reserved,
+//            chunk size (u32), max buffer size (u64), sample count (u64)
+//   chunk:   varint sample count, varint payload bytes, payload
+//   end:     a chunk with a sample count of 0
+//
+// All fixed width fields are little-endian.  Every chunk is encoded on its
+// own, so reading and writing only ever hold one chunk in memory.
+//
+// Payload encodings:
+//   COMPRESSION_NONE          raw little-endian samples
+//   COMPRESSION_DELTA_VARINT  zigzag varint deltas, integral types only
+//   COMPRESSION_XOR           Gorilla-style XOR of consecutive bit patterns,
+//                             float / double only
+class ofxDataBufferSerializer {
+public:
+    enum Compression {
+        COMPRESSION_NONE         = 0,
+        COMPRESSION_DELTA_VARINT = 1,
+        COMPRESSION_XOR          = 2
+    };
+
+    enum {
+        VERSION            = 1,
+        DEFAULT_CHUNK_SIZE = 4096,
+        MAX_CHUNK_SIZE     = 1 << 20 // bounds what a corrupt header can make readChunk() allocate
+    };
+
+    // Larger max buffer sizes are taken as corrupt, which also bounds what a
+    // reader sizes for them (e.g. ofxDataBuffer_'s pyramid).  Neither side
+    // accepts a header beyond it.
+    static const uint64_t MAX_BUFFER_SIZE = (uint64_t)1 << 36;
+
+    struct Header {
+        uint8_t     typeCode;
+        Compression compression;
+        uint32_t    chunkSize;
+        uint64_t    maxSize;
+        uint64_t    count;
+    };
+
+    // sinks and sources accepted by the read / write functions below
+
+    class StreamSink {
+    public:
+        StreamSink(ostream& _stream): stream(_stream) { }
+        bool write(const void* data, size_t size) {
+            stream.write(static_cast<const char*>(data), size);
+            return stream.good();
+        }
+    private:
+        ostream& stream;
+    };
+
+    class StreamSource {
+    public:
+        StreamSource(istream& _stream): stream(_stream) { }
+        bool read(void* data, size_t size) {
+            stream.read(static_cast<char*>(data), size);
+            return (size_t)stream.gcount() == size;
+        }
+    private:
+        istream& stream;
+    };
+
+    class FdSink {
+    public:
+        FdSink(int _fd): fd(_fd) { }
+        bool write(const void* data, size_t size) {
+            const char* p = static_cast<const char*>(data);
+            while(size > 0) {
+                long n = ::write(fd, p, size);
+                if(n < 0 && errno == EINTR) continue;
+                if(n <= 0) return false;
+                p    += n;
+                size -= n;
+            }
+            return true;
+        }
+    private:
+        int fd;
+    };
+
+    class FdSource {
+    public:
+        FdSource(int _fd): fd(_fd) { }
+        bool read(void* data, size_t size) {
+            char* p = static_cast<char*>(data);
+            while(size > 0) {
+                long n = ::read(fd, p, size);
+                if(n < 0 && errno == EINTR) continue;
+                if(n <= 0) return false;
+                p    += n;
+                size -= n;
+            }
+            return true;
+        }
+    private:
+        int fd;
+    };
+
+    template<typename T>
+    static uint8_t getTypeCode() {
+        return (uint8_t)(sizeof(T)
+                       | (numeric_limits<T>::is_integer ? 0x10 : 0)
+                       | (numeric_limits<T>::is_signed  ? 0x20 : 0));
+    }
+
+    template<typename T>
+    static bool supports(Compression compression) {
+        switch(compression) {
+            case COMPRESSION_NONE:
+                return sizeof(T) <= 8;
+            case COMPRESSION_DELTA_VARINT:
+                return numeric_limits<T>::is_integer && sizeof(T) <= 8;
+            case COMPRESSION_XOR:
+                return !numeric_limits<T>::is_integer && (sizeof(T) == 4 || sizeof(T) == 8);
+        }
+        return false;
+    }
+
+    template<typename T>
+    static Header makeHeader(Compression compression, size_t maxSize, size_t count, size_t chunkSize = DEFAULT_CHUNK_SIZE) {
+        Header header;
+        header.typeCode    = getTypeCode<T>();
+        header.compression = compression;
+        header.chunkSize   = chunkSize;
+        header.maxSize     = maxSize;
+        header.count       = count;
+        return header;
+    }
+
+    template<typename Sink>
+    static bool writeHeader(Sink& sink, const Header& header) {
+        if(!isValidHeader(header)) return false;
+
+        uint8_t bytes[32];
+        memcpy(bytes, "OFXDBSER", 8);
+        bytes[8]  = VERSION;
+        bytes[9]  = header.typeCode;
+        bytes[10] = header.compression;
+        bytes[11] = 0;
+        putLE(bytes + 12, header.chunkSize, 4);
+        putLE(bytes + 16, header.maxSize,   8);
+        putLE(bytes + 24, header.count,     8);
+        return sink.write(bytes, sizeof(bytes));
+    }
+
+    template<typename Source>
+    static bool readHeader(Source& source, Header& header) {
+        uint8_t bytes[32];
+        if(!source.read(bytes, sizeof(bytes))) return false;
+        if(memcmp(bytes, "OFXDBSER", 8) != 0 || bytes[8] != VERSION) return false;
+        if(bytes[10] > COMPRESSION_XOR) return false;
+
+        header.typeCode    = bytes[9];
+        header.compression = (Compression)bytes[10];
+        header.chunkSize   = (uint32_t)getLE(bytes + 12, 4);
+        header.maxSize     = getLE(bytes + 16, 8);
+        header.count       = getLE(bytes + 24, 8);
+
+        return isValidHeader(header);
+    }
+
+    static bool isValidHeader(const Header& header) {
+        return header.chunkSize > 0
+            && header.chunkSize <= MAX_CHUNK_SIZE
+            && header.maxSize   <= MAX_BUFFER_SIZE
+            && header.maxSize   <= numeric_limits<size_t>::max()
+            && header.count     <= header.maxSize;
+    }
+
+    // n must not exceed header.chunkSize
+    template<typename T, typename Sink>
+    static bool writeChunk(Sink& sink, const Header& header, const T* values, size_t n, vector<uint8_t>& scratch) {
+        if(n == 0) return true; // a zero count would end the stream
+
+        scratch.clear();
+        encode(header.compression, values, n, scratch);
+
+        uint8_t prefix[20];
+        size_t  length = putVarint(prefix, n);
+        length += putVarint(prefix + length, scratch.size());
+
+        return sink.write(prefix, length) && sink.write(&scratch[0], scratch.size());
+    }
+
+    template<typename Sink>
+    static bool writeEnd(Sink& sink) {
+        uint8_t end = 0;
+        return sink.write(&end, 1);
+    }
+
+    // Reads the next chunk into values.  Returns false on a malformed or
+    // truncated stream; an empty values vector marks the end.
+    template<typename T, typename Source>
+    static bool readChunk(Source& source, const Header& header, vector<T>& values, vector<uint8_t>& scratch) {
+        values.clear();
+
+        uint64_t n      = 0;
+        uint64_t length = 0;
+
+        if(!readVarint(source, n)) return false;
+        if(n == 0) return true;
+        if(n > header.chunkSize || !readVarint(source, length)) return false;
+
+        // the largest encoding is a 10 byte varint or 1 + 5 + 6 + 64 bits per sample
+        if(length > n * 11 + 8) return false;
+
+        scratch.resize(length);
+        if(length > 0 && !source.read(&scratch[0], length)) return false;
+
+        return decode(header.compression, scratch, n, values);
+    }
+
+private:
+    static void putLE(uint8_t* out, uint64_t v, size_t size) {
+        for(size_t i = 0; i < size; ++i) out[i] = (uint8_t)(v >> (8 * i));
+    }
+
+    static uint64_t getLE(const uint8_t* in, size_t size) {
+        uint64_t v = 0;
+        for(size_t i = 0; i < size; ++i) v |= (uint64_t)in[i] << (8 * i);
+        return v;
+    }
+
+    static size_t putVarint(uint8_t* out, uint64_t v) {
+        size_t i = 0;
+        while(v >= 0x80) {
+            out[i++] = (uint8_t)(v | 0x80);
+            v >>= 7;
+        }
+        out[i++] = (uint8_t)v;
+        return i;
+    }
+
+    static void appendVarint(vector<uint8_t>& out, uint64_t v) {
+        while(v >= 0x80) {
+            out.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((uint8_t)v);
+    }
+
+    static bool getVarint(const vector<uint8_t>& in, size_t& pos, uint64_t& v) {
+        v = 0;
+        for(int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+            uint8_t b = in[pos++];
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if(!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    template<typename Source>
+    static bool readVarint(Source& source, uint64_t& v) {
+        v = 0;
+        for(int shift = 0; shift < 64; shift += 7) {
+            uint8_t b;
+            if(!source.read(&b, 1)) return false;
+            v |= (uint64_t)(b & 0x7F) << shift;
+            if(!(b & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // the bit pattern of a sample, independent of host endianness
+    template<typename T>
+    static uint64_t toBits(const T& value) {
+        switch(sizeof(T)) {
+            case 1: { uint8_t  b; memcpy(&b, &value, 1); return b; }
+            case 2: { uint16_t b; memcpy(&b, &value, 2); return b; }
+            case 4: { uint32_t b; memcpy(&b, &value, 4); return b; }
+            default: { uint64_t b; memcpy(&b, &value, 8); return b; }
+        }
+    }
+
+    template<typename T>
+    static T fromBits(uint64_t bits) {
+        T value;
+        switch(sizeof(T)) {
+            case 1: { uint8_t  b = (uint8_t)bits;  memcpy(&value, &b, 1); break; }
+            case 2: { uint16_t b = (uint16_t)bits; memcpy(&value, &b, 2); break; }
+            case 4: { uint32_t b = (uint32_t)bits; memcpy(&value, &b, 4); break; }
+            default: { memcpy(&value, &bits, 8); break; }
+        }
+        return value;
+    }
+
+    // sign-extended for signed integral types, so deltas stay small
+    template<typename T>
+    static uint64_t toInteger(const T& value) {
+        return numeric_limits<T>::is_signed ? (uint64_t)(int64_t)value : (uint64_t)value;
+    }
+
+    static int countLeadingZeros(uint64_t v) {
+#if defined(__GNUC__)
+        return v == 0 ? 64 : __builtin_clzll(v);
+#else
+        int n = 0;
+        for(uint64_t mask = 1ULL << 63; mask != 0 && !(v & mask); mask >>= 1) n++;
+        return n;
+#endif
+    }
+
+    static int countTrailingZeros(uint64_t v) {
+#if defined(__GNUC__)
+        return v == 0 ? 64 : __builtin_ctzll(v);
+#else
+        int n = 0;
+        for(uint64_t mask = 1; mask != 0 && !(v & mask); mask <<= 1) n++;
+        return n;
+#endif
+    }
+
+    class BitWriter {
+    public:
+        BitWriter(vector<uint8_t>& _out): out(_out), used(8) { }
+        void write(uint64_t bits, int count) { // msb first
+            while(count > 0) {
+                if(used == 8) {
+                    out.push_back(0);
+                    used = 0;
+                }
+                int take = count < 8 - used ? count : 8 - used;
+                uint8_t chunk = (uint8_t)((bits >> (count - take)) & ((1u << take) - 1));
+                out.back() |= (uint8_t)(chunk << (8 - used - take));
+                used  += take;
+                count -= take;
+            }
+        }
+    private:
+        vector<uint8_t>& out;
+        int used;
+    };
+
+    class BitReader {
+    public:
+        BitReader(const vector<uint8_t>& _in): in(_in), pos(0) { }
+        bool read(int count, uint64_t& bits) {
+            bits = 0;
+            if(pos + count > in.size() * 8) return false;
+            while(count > 0) {
+                int used = pos & 7;
+                int take = count < 8 - used ? count : 8 - used;
+                uint8_t chunk = (uint8_t)((in[pos >> 3] >> (8 - used - take)) & ((1u << take) - 1));
+                bits   = (bits << take) | chunk;
+                pos   += take;
+                count -= take;
+            }
+            return true;
+        }
+    private:
+        const vector<uint8_t>& in;
+        size_t pos;
+    };
+
+    template<typename T>
+    static void encode(Compression compression, const T* values, size_t n, vector<uint8_t>& out) {
+        if(compression == COMPRESSION_DELTA_VARINT) {
+            uint64_t previous = 0;
+            for(size_t i = 0; i < n; ++i) {
+                uint64_t current = toInteger(values[i]);
+                int64_t  delta   = (int64_t)(current - previous);
+                appendVarint(out, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63)); // zigzag
+                previous = current;
+            }
+        } else if(compression == COMPRESSION_XOR) {
+            const int width = sizeof(T) * 8;
+
+            BitWriter writer(out);
+
+            uint64_t previous = toBits(values[0]);
+            writer.write(previous, width);
+
+            int leading  = -1; // no window yet
+            int trailing = 0;
+
+            for(size_t i = 1; i < n; ++i) {
+                uint64_t current = toBits(values[i]);
+                uint64_t x       = current ^ previous;
+                previous = current;
+
+                if(x == 0) {
+                    writer.write(0, 1);
+                    continue;
+                }
+
+                int lz = countLeadingZeros(x) - (64 - width);
+                int tz = countTrailingZeros(x);
+                if(lz > 31) lz = 31;
+
+                if(leading >= 0 && lz >= leading && tz >= trailing) {
+                    // fits in the previous window
+                    writer.write(2, 2);
+                    writer.write(x >> trailing, width - leading - trailing);
+                } else {
+                    leading  = lz;
+                    trailing = tz;
+                    int meaningful = width - leading - trailing;
+                    writer.write(3, 2);
+                    writer.write(leading, 5);
+                    writer.write(meaningful - 1, 6);
+                    writer.write(x >> trailing, meaningful);
+                }
+            }
+        } else {
+            for(size_t i = 0; i < n; ++i) {
+                uint64_t bits = toBits(values[i]);
+                for(size_t b = 0; b < sizeof(T); ++b) out.push_back((uint8_t)(bits >> (8 * b)));
+            }
+        }
+    }
+
+    template<typename T>
+    static bool decode(Compression compression, const vector<uint8_t>& in, size_t n, vector<T>& values) {
+        values.reserve(n);
+
+        if(compression == COMPRESSION_DELTA_VARINT) {
+            uint64_t previous = 0;
+            size_t   pos      = 0;
+            for(size_t i = 0; i < n; ++i) {
+                uint64_t zigzag;
+                if(!getVarint(in, pos, zigzag)) return false;
+                previous += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+                values.push_back(numeric_limits<T>::is_signed ? (T)(int64_t)previous : (T)previous);
+            }
+        } else if(compression == COMPRESSION_XOR) {
+            const int width = sizeof(T) * 8;
+
+            BitReader reader(in);
+
+            uint64_t previous;
+            if(!reader.read(width, previous)) return false;
+            values.push_back(fromBits<T>(previous));
+
+            int leading  = -1;
+            int trailing = 0;
+
+            for(size_t i = 1; i < n; ++i) {
+                uint64_t control;
+                if(!reader.read(1, control)) return false;
+
+                if(control != 0) {
+                    if(!reader.read(1, control)) return false;
+
+                    if(control != 0) {
+                        uint64_t lz, meaningful;
+                        if(!reader.read(5, lz) || !reader.read(6, meaningful)) return false;
+                        leading  = (int)lz;
+                        trailing = width - leading - (int)meaningful - 1;
+                        if(trailing < 0) return false;
+                    } else if(leading < 0) {
+                        return false;
+                    }
+
+                    uint64_t x;
+                    if(!reader.read(width - leading - trailing, x)) return false;
+                    previous ^= x << trailing;
+                }
+
+                values.push_back(fromBits<T>(previous));
+            }
+        } else {
+            if(in.size() != n * sizeof(T)) return false;
+            for(size_t i = 0; i < n; ++i) {
+                uint64_t bits = 0;
+                for(size_t b = 0; b < sizeof(T); ++b) bits |= (uint64_t)in[i * sizeof(T) + b] << (8 * b);
+                values.push_back(fromBits<T>(bits));
+            }
+        }
+
+        return true;
+    }
+
+};
@@ -0,0 +1,340 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// A multi-resolution aggregation pyramid (bottom-up segment tree) over a fixed
+// number of slots.  Each level 0 block covers LEAF_SIZE slots and level k
+// blocks cover LEAF_SIZE * 2^k.  Every block caches min / max / sum / count,
+// so updating a slot costs O(LEAF_SIZE + log n) and querying any contiguous
+// slot range O(LEAF_SIZE + log n).
+//
+// The pyramid keeps its own copy of the slots, plus roughly 4 blocks per
+// LEAF_SIZE slots in the worst case, i.e. sizeof(T) + 1 to 2 bytes per slot.
+template<typename T>
+class ofxDataPyramid_ {
+public:
+    enum {
+        LEAF_SIZE = 64 // slots per level 0 block
+    };
+
+    struct Block {
+        T      minimum;
+        T      maximum;
+        double sum;
+        size_t count;
+    };
+
+    ofxDataPyramid_();
+    ofxDataPyramid_(size_t capacity);
+
+    virtual ~ofxDataPyramid_();
+
+    // Clears all slots.  Returns false and leaves the pyramid as it was if
+    // capacity is too large to index.
+    bool   setCapacity(size_t capacity);
+    size_t getCapacity() const;
+
+    void   clear();
+    void   swap(ofxDataPyramid_& other);
+
+    void   set(size_t slot, const T& value);
+    void   erase(size_t slot);
+
+    // aggregate over the slot range [first, last)
+    Block  query(size_t first, size_t last) const;
+
+    size_t getNumLevels() const;
+    size_t getNumBlocks(size_t level) const;
+    const Block& getBlock(size_t level, size_t index) const;
+
+    size_t getNumBytes() const; // heap memory held by the slots and blocks
+
+    static Block emptyBlock();
+    static Block combine(const Block& a, const Block& b);
+
+private:
+    void   update(size_t leaf);
+    Block  scan(size_t first, size_t last) const;
+
+    size_t capacity;
+    size_t numLeaves; // capacity / LEAF_SIZE rounded up to a power of two
+    size_t numLevels;
+
+    vector<T>    slots;
+    vector<bool> occupied;
+
+    // nodes[1] is the root, leaves start at nodes[numLeaves]
+    vector<Block> nodes;
+
+};
+
+template<typename T>
+ofxDataPyramid_<T>::ofxDataPyramid_(){
+    setCapacity(0);
+}
+
+template<typename T>
+ofxDataPyramid_<T>::ofxDataPyramid_(size_t _capacity){
+    setCapacity(0);
+    setCapacity(_capacity);
+}
+
+template<typename T>
+ofxDataPyramid_<T>::~ofxDataPyramid_(){}
+
+template<typename T>
+bool ofxDataPyramid_<T>::setCapacity(size_t _capacity){
+    size_t leaves = _capacity / LEAF_SIZE + (_capacity % LEAF_SIZE != 0);
+    size_t n      = 1;
+    size_t levels = 1;
+
+    while(n < leaves) {
+        if(n > numeric_limits<size_t>::max() / 4) return false; // 2 * n would overflow
+        n <<= 1;
+        levels++;
+    }
+
+    // max_size() also keeps the byte counts from overflowing
+    if(_capacity > slots.max_size() || 2 * n > nodes.max_size()) return false;
+
+    // allocate before touching anything, so a bad_alloc leaves us as we were
+    vector<T>     newSlots(_capacity);
+    vector<bool>  newOccupied(_capacity, false);
+    vector<Block> newNodes(2 * n, emptyBlock());
+
+    slots.swap(newSlots);
+    occupied.swap(newOccupied);
+    nodes.swap(newNodes);
+
+    capacity  = _capacity;
+    numLeaves = n;
+    numLevels = levels;
+
+    return true;
+}
+
+template<typename T>
+size_t ofxDataPyramid_<T>::getCapacity() const {
+    return capacity;
+}
+
+template<typename T>
+void ofxDataPyramid_<T>::clear(){
+    occupied.assign(capacity, false);
+    nodes.assign(2 * numLeaves, emptyBlock());
+}
+
+template<typename T>
+void ofxDataPyramid_<T>::swap(ofxDataPyramid_& other){
+    std::swap(capacity,  other.capacity);
+    std::swap(numLeaves, other.numLeaves);
+    std::swap(numLevels, other.numLevels);
+    slots.swap(other.slots);
+    occupied.swap(other.occupied);
+    nodes.swap(other.nodes);
+}
+
+template<typename T>
+void ofxDataPyramid_<T>::set(size_t slot, const T& value){
+    size_t leaf = slot / LEAF_SIZE;
+    Block& block = nodes[numLeaves + leaf];
+
+    if(occupied[slot]) {
+        T old = slots[slot];
+        slots[slot] = value;
+
+        // Rescan when the old value may have been the min or max, and when
+        // writing the leaf's last slot so the running sum can't drift over
+        // many passes.  Otherwise the block is patched in place.
+        bool lastInLeaf = (slot + 1) % LEAF_SIZE == 0 || slot + 1 == capacity;
+
+        if(lastInLeaf || !(old > block.minimum && old < block.maximum)) {
+            block = scan(leaf * LEAF_SIZE, std::min((leaf + 1) * LEAF_SIZE, capacity));
+        } else {
+            if(value < block.minimum) block.minimum = value;
+            if(value > block.maximum) block.maximum = value;
+            block.sum += (double)value - (double)old;
+        }
+    } else {
+        Block single;
+        single.minimum = value;
+        single.maximum = value;
+        single.sum     = value;
+        single.count   = 1;
+
+        slots[slot]    = value;
+        occupied[slot] = true;
+        block = combine(block, single);
+    }
+
+    update(leaf);
+}
+
+template<typename T>
+void ofxDataPyramid_<T>::erase(size_t slot){
+    if(!occupied[slot]) return;
+
+    occupied[slot] = false;
+
+    // reset first, the stale count would send scan() down the full leaf path
+    size_t leaf = slot / LEAF_SIZE;
+    nodes[numLeaves + leaf] = emptyBlock();
+    nodes[numLeaves + leaf] = scan(leaf * LEAF_SIZE, std::min((leaf + 1) * LEAF_SIZE, capacity));
+
+    update(leaf);
+}
+
+template<typename T>
+void ofxDataPyramid_<T>::update(size_t leaf){
+    for(size_t node = (numLeaves + leaf) >> 1; node > 0; node >>= 1) {
+        nodes[node] = combine(nodes[2 * node], nodes[2 * node + 1]);
+    }
+}
+
+template<typename T>
+typename ofxDataPyramid_<T>::Block ofxDataPyramid_<T>::scan(size_t first, size_t last) const {
+    Block result = emptyBlock();
+
+    while(first < last) {
+        size_t leaf = first / LEAF_SIZE;
+        size_t end  = std::min((leaf + 1) * LEAF_SIZE, last);
+
+        size_t leafLength = std::min((leaf + 1) * LEAF_SIZE, capacity) - leaf * LEAF_SIZE;
+
+        if(nodes[numLeaves + leaf].count == leafLength) {
+            // a full leaf, no need to look at the occupancy bits
+            Block run;
+            run.minimum = slots[first];
+            run.maximum = slots[first];
+            run.sum     = 0.0;
+            run.count   = end - first;
+
+            for(size_t i = first; i < end; ++i) {
+                T value = slots[i];
+                if(value < run.minimum) run.minimum = value;
+                if(value > run.maximum) run.maximum = value;
+                run.sum += value;
+            }
+
+            result = combine(result, run);
+        } else {
+            for(size_t i = first; i < end; ++i) {
+                if(!occupied[i]) continue;
+
+                T value = slots[i];
+
+                if(result.count == 0) {
+                    result.minimum = value;
+                    result.maximum = value;
+                } else {
+                    if(value < result.minimum) result.minimum = value;
+                    if(value > result.maximum) result.maximum = value;
+                }
+
+                result.sum += value;
+                result.count++;
+            }
+        }
+
+        first = end;
+    }
+
+    return result;
+}
+
+template<typename T>
+typename ofxDataPyramid_<T>::Block ofxDataPyramid_<T>::query(size_t first, size_t last) const {
+    if(last > capacity) last = capacity;
+    if(first >= last) return emptyBlock();
+
+    // whole leaves [l, r) come from the tree, the partial ones at either
+    // edge are scanned
+    size_t l = first / LEAF_SIZE + (first % LEAF_SIZE != 0);
+    size_t r = last  / LEAF_SIZE;
+
+    if(l >= r) return scan(first, last);
+
+    Block result = scan(first, l * LEAF_SIZE);
+
+    // walk both edges of the leaf range up the tree
+    size_t left  = l + numLeaves;
+    size_t right = r + numLeaves;
+
+    while(left < right) {
+        if(left  & 1) result = combine(result, nodes[left++]);
+        if(right & 1) result = combine(result, nodes[--right]);
+        left  >>= 1;
+        right >>= 1;
+    }
+
+    return combine(result, scan(r * LEAF_SIZE, last));
+}
+
+template<typename T>
+size_t ofxDataPyramid_<T>::getNumLevels() const {
+    return numLevels;
+}
+
+template<typename T>
+size_t ofxDataPyramid_<T>::getNumBlocks(size_t level) const {
+    return numLeaves >> level;
+}
+
+template<typename T>
+const typename ofxDataPyramid_<T>::Block& ofxDataPyramid_<T>::getBlock(size_t level, size_t index) const {
+    return nodes[(numLeaves >> level) + index];
+}
+
+template<typename T>
+size_t ofxDataPyramid_<T>::getNumBytes() const {
+    return capacity * sizeof(T) + capacity / 8 + nodes.size() * sizeof(Block);
+}
+
+template<typename T>
+typename ofxDataPyramid_<T>::Block ofxDataPyramid_<T>::emptyBlock(){
+    Block b;
+    b.minimum = T(); // never read while count == 0
+    b.maximum = T();
+    b.sum     = 0.0;
+    b.count   = 0;
+    return b;
+}
+
+template<typename T>
+typename ofxDataPyramid_<T>::Block ofxDataPyramid_<T>::combine(const Block& a, const Block& b){
+    if(a.count == 0) return b;
+    if(b.count == 0) return a;
+
+    Block c;
+    c.minimum = b.minimum < a.minimum ? b.minimum : a.minimum;
+    c.maximum = b.maximum > a.maximum ? b.maximum : a.maximum;
+    c.sum     = a.sum   + b.sum;
+    c.count   = a.count + b.count;
+    return c;
+}
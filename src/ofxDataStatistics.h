@@ -0,0 +1,141 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdint.h>
+
+// Whole-window statistics shared by the data buffers.  Fixed width fields
+// only, so ofxMappedDataBuffer_ can keep a copy in its file header.  The
+// min / max values themselves are read back through their indices.
+struct ofxDataStatistics {
+    uint64_t minimumIdx;
+    uint64_t maximumIdx;
+
+    double sum;
+    double product;
+    double variance;
+    double variancePopulation;
+
+    double mean;
+    double harmMean;
+    double geoMean;
+    double stdDev;
+    double stdDevPopulation;
+};
+
+// One pass over values[0] ... values[size - 1].  Values can be anything with
+// an operator[] returning a T.  An empty window leaves everything at 0.
+template<typename T, typename Values>
+void ofxCalcStatistics(const Values& values, size_t size, ofxDataStatistics& stats){
+
+    stats.minimumIdx         = 0;
+    stats.maximumIdx         = 0;
+    stats.sum                = 0.0;
+    stats.product            = 0.0;
+    stats.variance           = 0.0;
+    stats.variancePopulation = 0.0;
+    stats.mean               = 0.0;
+    stats.harmMean           = 0.0;
+    stats.geoMean            = 0.0;
+    stats.stdDev             = 0.0;
+    stats.stdDevPopulation   = 0.0;
+
+    if(size == 0) return;
+
+    bool hasNegativeValues = false;
+
+    int    n      = 0;
+    double delta  = 0.0;
+    double M2     = 0.0;
+    double invSum = 0.0;
+
+    T minimum = values[0];
+    T maximum = values[0];
+
+    for(size_t i = 0; i < size; ++i) {
+        T         value = values[i];
+        double invValue = 1.0 / value;
+        if(value < 0) hasNegativeValues = true;
+
+        n = n+1;
+
+        if(i == 0) {
+            stats.sum     = value;
+            stats.product = value;
+            invSum        = invValue;
+        } else {
+            stats.sum     += value;
+            stats.product *= value;
+            invSum        += invValue;
+
+            if(value < minimum) {
+                minimum          = value;
+                stats.minimumIdx = i;
+            }
+
+            if(value > maximum) {
+                maximum          = value;
+                stats.maximumIdx = i;
+            }
+        }
+
+        delta      = value - stats.mean;
+        stats.mean = stats.mean + delta/n;
+        M2         = M2 + delta * (value - stats.mean);
+    }
+
+    stats.harmMean           = hasNegativeValues ? -1 : (n / invSum);
+    stats.geoMean            = hasNegativeValues ? -1 : pow(stats.product, 1.0 / n);
+
+    stats.variancePopulation = M2 / (n);
+    stats.variance           = M2 / (n - 1);
+
+    stats.stdDevPopulation   = sqrt(stats.variancePopulation);
+    stats.stdDev             = sqrt(stats.variance);
+}
+
+// Median of values[0] ... values[size - 1], using a temporary copy.
+template<typename T, typename Values>
+double ofxCalcMedian(const Values& values, size_t size){
+    if(size == 0) return 0.0;
+
+    vector<T> copy(size);
+    for(size_t i = 0; i < size; ++i) copy[i] = values[i];
+
+    size_t n = size / 2;
+
+    std::nth_element(copy.begin(), copy.begin()+n, copy.end());
+    double med = copy[n];
+
+    if(size % 2 != 0) { // odd
+        return med;
+    } else { // even, the lower middle is the largest of the lower half
+        return (med + *std::max_element(copy.begin(), copy.begin()+n)) / 2.0;
+    }
+}
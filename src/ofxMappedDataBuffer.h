@@ -0,0 +1,511 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+#pragma once
+
+#if !defined(TARGET_WIN32)
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ofxDataStatistics.h"
+#include "ofxDataBufferSerializer.h"
+
+// A ring buffer of samples living in a memory-mapped file, so a window
+// survives restarts and can be read zero-copy by other processes.
+//
+// File layout: a fixed header page (ofxMappedDataBufferHeader) followed by
+// capacity raw samples.  Samples must be trivially copyable and the file is
+// only portable between machines with the same endianness.
+//
+// There is no locking; a reader racing a writer may see a half written
+// sample or stale statistics.  Synchronize externally if that matters.
+//
+// A writer killed mid push_back() leaves a file that still opens: head and
+// count are each committed with a single store and tail is rederived from
+// them on open, so at worst the oldest sample has been replaced by the new
+// one.  The generation is bumped before anything else changes, so cached
+// statistics are never mistaken for current ones.
+
+struct ofxMappedDataBufferStats {
+    uint64_t          generation; // header generation these stats were computed for
+    ofxDataStatistics values;
+};
+
+struct ofxMappedDataBufferHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t elementSize;
+    uint32_t typeCode;   // ofxDataBufferSerializer::getTypeCode<T>()
+    uint32_t reserved;
+    uint64_t capacity;
+    uint64_t head;       // slot of the first sample
+    uint64_t tail;       // slot the next sample is written to, (head + count) % capacity
+    uint64_t count;
+    uint64_t generation; // bumped on every modification
+
+    ofxMappedDataBufferStats stats;
+};
+
+template<typename T>
+class ofxMappedDataBuffer_ {
+public:
+    static const char* const MAGIC; // 8 bytes including the terminator
+
+    enum {
+        VERSION     = 3,
+        DATA_OFFSET = 4096 // samples start on their own page
+    };
+
+    ofxMappedDataBuffer_();
+
+    virtual ~ofxMappedDataBuffer_();
+
+    // Maps path, creating it with room for maxSize samples if it does not
+    // exist.  An existing file keeps its contents; maxSize must then be 0 or
+    // match the stored capacity.  Read-only maps never modify the file.
+    bool open(const string& path, size_t maxSize, bool readOnly = false);
+    void close();
+
+    bool isOpen() const;
+    bool isReadOnly() const;
+
+    // flush dirty pages to disk
+    bool sync(bool async = false);
+
+    void push_back(const T& data);
+    void push_back(const vector<T>& v);
+    void push_back(T* v, int length);
+
+    void clear();
+
+    size_t getMaxBufferSize() const;
+    size_t getSize() const;
+
+    T      get(size_t i) const; // i = 0 is the oldest sample
+    T      operator[](size_t i) const;
+
+    // buffer statistics
+    void calcStats();
+    bool isStatsValid() const;
+
+    T      getLast();
+    T      getFirst();
+
+    T      getMin();
+    T      getMax();
+
+    size_t getMinIndex();
+    size_t getMaxIndex();
+
+    double getSum();
+    double getProduct();
+    double getMean();
+    double getHarmonicMean();
+    double getGeometricMean();
+    double getVariance();
+    double getStdDev();
+    double getPopulationVariance();
+    double getPopulationStdDev();
+
+    double getMedian();
+
+    const ofxMappedDataBufferHeader* getHeader() const;
+    const T* getData() const; // raw ring storage, capacity slots
+
+private:
+    // owns a file descriptor and a mapping, so it can't be copied
+    ofxMappedDataBuffer_(const ofxMappedDataBuffer_&);
+    ofxMappedDataBuffer_& operator=(const ofxMappedDataBuffer_&);
+
+    bool isValidHeader(size_t maxSize) const;
+
+    ofxMappedDataBufferStats& stats();
+
+    int    fd;
+    bool   readOnly;
+    size_t mappedLength;
+    void*  mapped;
+
+    ofxMappedDataBufferHeader* header;
+    T*     data;
+
+    // read-only maps can't write cached stats back to the header
+    ofxMappedDataBufferStats localStats;
+
+};
+
+template<typename T>
+const char* const ofxMappedDataBuffer_<T>::MAGIC = "OFXDBUF";
+
+template<typename T>
+ofxMappedDataBuffer_<T>::ofxMappedDataBuffer_(){
+    fd           = -1;
+    readOnly     = false;
+    mappedLength = 0;
+    mapped       = NULL;
+    header       = NULL;
+    data         = NULL;
+    memset(&localStats, 0, sizeof(localStats));
+}
+
+template<typename T>
+ofxMappedDataBuffer_<T>::~ofxMappedDataBuffer_(){
+    close();
+}
+
+template<typename T>
+bool ofxMappedDataBuffer_<T>::open(const string& path, size_t maxSize, bool _readOnly){
+    close();
+
+    readOnly = _readOnly;
+    fd = ::open(path.c_str(), readOnly ? O_RDONLY : (O_RDWR | O_CREAT), 0644);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close();
+        return false;
+    }
+
+    bool created = (st.st_size == 0);
+
+    if(created) {
+        if(readOnly || maxSize == 0) {
+            close();
+            return false;
+        }
+
+        if(maxSize > (numeric_limits<size_t>::max() - DATA_OFFSET) / sizeof(T)) {
+            close();
+            return false;
+        }
+
+        // sparse; the OS only backs the pages we touch
+        mappedLength = DATA_OFFSET + maxSize * sizeof(T);
+        if(ftruncate(fd, mappedLength) != 0) {
+            close();
+            return false;
+        }
+    } else {
+        if((size_t)st.st_size < (size_t)DATA_OFFSET) {
+            close();
+            return false;
+        }
+        mappedLength = st.st_size;
+    }
+
+    mapped = mmap(NULL,
+                  mappedLength,
+                  readOnly ? PROT_READ : (PROT_READ | PROT_WRITE),
+                  MAP_SHARED,
+                  fd,
+                  0);
+
+    if(mapped == MAP_FAILED) {
+        mapped = NULL;
+        close();
+        return false;
+    }
+
+    header = static_cast<ofxMappedDataBufferHeader*>(mapped);
+    data   = reinterpret_cast<T*>(static_cast<char*>(mapped) + DATA_OFFSET);
+
+    if(created) {
+        memset(header, 0, sizeof(ofxMappedDataBufferHeader));
+        memcpy(header->magic, MAGIC, sizeof(header->magic));
+        header->version     = VERSION;
+        header->elementSize = sizeof(T);
+        header->typeCode    = ofxDataBufferSerializer::getTypeCode<T>();
+        header->capacity    = maxSize;
+        header->generation  = 1; // stats start out invalid
+    } else if(!isValidHeader(maxSize)) {
+        close();
+        return false;
+    } else if(!readOnly) {
+        header->tail = (header->head + header->count) % header->capacity;
+    }
+
+    localStats = header->stats;
+
+    return true;
+}
+
+template<typename T>
+bool ofxMappedDataBuffer_<T>::isValidHeader(size_t maxSize) const {
+    // the file may have been left behind by a crash or written by someone
+    // else, so nothing in it is trusted
+    if(memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0
+       || header->version     != VERSION
+       || header->elementSize != sizeof(T)
+       || header->typeCode    != ofxDataBufferSerializer::getTypeCode<T>()) {
+        return false;
+    }
+
+    uint64_t capacity = header->capacity;
+
+    if(capacity == 0
+       || (maxSize != 0 && capacity != maxSize)
+       || capacity > (mappedLength - DATA_OFFSET) / sizeof(T)) {
+        return false;
+    }
+
+    // tail isn't checked, open() rederives it
+    return header->head < capacity && header->count <= capacity;
+}
+
+template<typename T>
+void ofxMappedDataBuffer_<T>::close(){
+    if(mapped != NULL) {
+        if(!readOnly) msync(mapped, mappedLength, MS_ASYNC);
+        munmap(mapped, mappedLength);
+    }
+
+    if(fd >= 0) ::close(fd);
+
+    fd           = -1;
+    mappedLength = 0;
+    mapped       = NULL;
+    header       = NULL;
+    data         = NULL;
+}
+
+template<typename T>
+bool ofxMappedDataBuffer_<T>::isOpen() const {
+    return header != NULL;
+}
+
+template<typename T>
+bool ofxMappedDataBuffer_<T>::isReadOnly() const {
+    return readOnly;
+}
+
+template<typename T>
+bool ofxMappedDataBuffer_<T>::sync(bool async){
+    if(mapped == NULL || readOnly) return false;
+    return msync(mapped, mappedLength, async ? MS_ASYNC : MS_SYNC) == 0;
+}
+
+template<typename T>
+void ofxMappedDataBuffer_<T>::push_back(const T& value){
+    if(header == NULL || readOnly || header->capacity == 0) return;
+
+    header->generation++;
+
+    uint64_t slot = (header->head + header->count) % header->capacity;
+    data[slot] = value;
+
+    if(header->count < header->capacity) {
+        header->count++;
+    } else {
+        header->head = (header->head + 1) % header->capacity; // overwrote the oldest sample
+    }
+
+    header->tail = (slot + 1) % header->capacity;
+}
+
+template<typename T>
+void ofxMappedDataBuffer_<T>::push_back(const vector<T>& v){
+    for(int i = 0; i < (int)v.size(); i++) push_back(v[i]);
+}
+
+template<typename T>
+void ofxMappedDataBuffer_<T>::push_back(T* v, int length){
+    for(int i = 0; i < length; i++) push_back(v[i]);
+}
+
+template<typename T>
+void ofxMappedDataBuffer_<T>::clear(){
+    if(header == NULL || readOnly) return;
+
+    header->generation++;
+    header->count = 0; // empty from here on, whatever head says
+    header->head  = 0;
+    header->tail  = 0;
+}
+
+template<typename T>
+size_t ofxMappedDataBuffer_<T>::getMaxBufferSize() const {
+    return header != NULL ? header->capacity : 0;
+}
+
+template<typename T>
+size_t ofxMappedDataBuffer_<T>::getSize() const {
+    return header != NULL ? header->count : 0;
+}
+
+template<typename T>
+T ofxMappedDataBuffer_<T>::get(size_t i) const {
+    return data[(header->head + i) % header->capacity];
+}
+
+template<typename T>
+T ofxMappedDataBuffer_<T>::operator[](size_t i) const {
+    return get(i);
+}
+
+template<typename T>
+ofxMappedDataBufferStats& ofxMappedDataBuffer_<T>::stats(){
+    return readOnly ? localStats : header->stats;
+}
+
+template<typename T>
+bool ofxMappedDataBuffer_<T>::isStatsValid() const {
+    if(header == NULL) return false;
+    const ofxMappedDataBufferStats& s = readOnly ? localStats : header->stats;
+    return s.generation == header->generation;
+}
+
+template<typename T>
+void ofxMappedDataBuffer_<T>::calcStats(){
+
+    if(header == NULL || isStatsValid()) return;
+
+    if(readOnly && header->stats.generation == header->generation) {
+        localStats = header->stats; // the writer already did the work
+        return;
+    }
+
+    ofxMappedDataBufferStats& s = stats();
+
+    // stamp last, so stats cut short by a crash stay invalid
+    ofxCalcStatistics<T>(*this, getSize(), s.values);
+    s.generation = header->generation;
+}
+
+template<typename T>
+T ofxMappedDataBuffer_<T>::getLast(){
+    return get(getSize()-1);
+}
+
+template<typename T>
+T ofxMappedDataBuffer_<T>::getFirst(){
+    return get(0);
+}
+
+template<typename T>
+T ofxMappedDataBuffer_<T>::getMin(){
+    calcStats();
+    return getSize() > 0 ? get(stats().values.minimumIdx) : T();
+}
+
+template<typename T>
+T ofxMappedDataBuffer_<T>::getMax(){
+    calcStats();
+    return getSize() > 0 ? get(stats().values.maximumIdx) : T();
+}
+
+template<typename T>
+size_t ofxMappedDataBuffer_<T>::getMinIndex(){
+    calcStats();
+    return stats().values.minimumIdx;
+}
+
+template<typename T>
+size_t ofxMappedDataBuffer_<T>::getMaxIndex(){
+    calcStats();
+    return stats().values.maximumIdx;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getSum(){
+    calcStats();
+    return stats().values.sum;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getProduct(){
+    calcStats();
+    return stats().values.product;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getMean(){
+    calcStats();
+    return stats().values.mean;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getHarmonicMean(){
+    calcStats();
+    return stats().values.harmMean;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getGeometricMean(){
+    calcStats();
+    return stats().values.geoMean;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getVariance(){
+    calcStats();
+    return stats().values.variance;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getStdDev(){
+    calcStats();
+    return stats().values.stdDev;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getPopulationVariance(){
+    calcStats();
+    return stats().values.variancePopulation;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getPopulationStdDev(){
+    calcStats();
+    return stats().values.stdDevPopulation;
+}
+
+template<typename T>
+double ofxMappedDataBuffer_<T>::getMedian(){
+    // median is not cached
+    return ofxCalcMedian<T>(*this, getSize());
+}
+
+template<typename T>
+const ofxMappedDataBufferHeader* ofxMappedDataBuffer_<T>::getHeader() const {
+    return header;
+}
+
+template<typename T>
+const T* ofxMappedDataBuffer_<T>::getData() const {
+    return data;
+}
+
+typedef ofxMappedDataBuffer_<float>  ofxMappedFloatDataBuffer;
+typedef ofxMappedDataBuffer_<double> ofxMappedDoubleDataBuffer;
+typedef ofxMappedDataBuffer_<int>    ofxMappedIntDataBuffer;
+
+#endif
@@ -0,0 +1,294 @@
+// =============================================================================
+//
+// Copyright (c) 2010-2013 Christopher Baker <http://christopherbaker.net>
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// =============================================================================
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+
+// Requires C++17.
+
+// Statistics an ofxStaticDataBuffer_ can provide, combined as a bit mask.
+// Asking for a statistic that was not selected fails to compile.
+struct ofxDataBufferStats {
+    enum {
+        SUM      = 1 << 0, // also enables the mean
+        VARIANCE = 1 << 1, // also enables the standard deviation
+        MIN      = 1 << 2,
+        MAX      = 1 << 3,
+        MEDIAN   = 1 << 4,
+        ALL      = SUM | VARIANCE | MIN | MAX | MEDIAN
+    };
+};
+
+// The running sum is the only statistic kept up to date on push_back(); it
+// lives in an empty base when SUM is not selected.
+//
+// lapSum adds up the samples written since slot 0 was last written.  When
+// slot N - 1 is written every slot has been rewritten, so lapSum is exactly
+// the window's sum and replaces the running one.  Rounding error can't build
+// up past one lap, NaN / inf samples stop affecting the sum by the end of
+// the lap that evicts them, and push_back() stays O(1).
+template<bool Enabled>
+class ofxStaticDataBufferSum_ {
+protected:
+    constexpr ofxStaticDataBufferSum_(): sum(0.0), lapSum(0.0) { }
+    double sum;
+    double lapSum;
+};
+
+template<>
+class ofxStaticDataBufferSum_<false> {
+};
+
+// A sliding window with a capacity fixed at compile time.  Samples live
+// inline in a std::array, so it never allocates, and everything except the
+// median and the standard deviations is usable in constant expressions.
+template<typename T, size_t N, unsigned Stats = ofxDataBufferStats::ALL>
+class ofxStaticDataBuffer_: private ofxStaticDataBufferSum_<(Stats & ofxDataBufferStats::SUM) != 0> {
+public:
+    static_assert(N > 0, "ofxStaticDataBuffer_ needs a capacity of at least one sample.");
+
+    constexpr ofxStaticDataBuffer_();
+
+    constexpr void push_back(const T& data);
+
+    constexpr void clear();
+
+    static constexpr size_t getMaxBufferSize() { return N; }
+
+    constexpr size_t getSize() const;
+    constexpr bool   isFull() const;
+
+    constexpr T operator[](size_t i) const; // i = 0 is the oldest sample
+
+    constexpr T      getLast() const;
+    constexpr T      getFirst() const;
+
+    constexpr T      getMin() const;
+    constexpr T      getMax() const;
+
+    constexpr size_t getMinIndex() const;
+    constexpr size_t getMaxIndex() const;
+
+    constexpr double getSum() const;
+    constexpr double getMean() const;
+    constexpr double getVariance() const;
+    constexpr double getPopulationVariance() const;
+
+    double getStdDev() const;
+    double getPopulationStdDev() const;
+
+    double getMedian() const;
+
+private:
+    static constexpr bool tracks(unsigned stat) { return (Stats & stat) != 0; }
+
+    constexpr double calcSum() const;
+    constexpr double calcM2() const; // sum of squared deviations
+
+    std::array<T, N> buffer;
+    size_t head; // slot of the oldest sample
+    size_t count;
+
+};
+
+template<typename T, size_t N, unsigned Stats>
+constexpr ofxStaticDataBuffer_<T, N, Stats>::ofxStaticDataBuffer_():
+    buffer(),
+    head(0),
+    count(0)
+{
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr void ofxStaticDataBuffer_<T, N, Stats>::push_back(const T& data){
+    bool   evicted = (count == N);
+    size_t slot    = (head + count) % N;
+
+    if(evicted) {
+        head = (head + 1) % N; // overwrite the oldest sample
+    } else {
+        count++;
+    }
+
+    if constexpr (tracks(ofxDataBufferStats::SUM)) {
+        if(evicted) this->sum -= buffer[slot];
+        this->sum += data;
+
+        this->lapSum = (slot == 0 ? 0.0 : this->lapSum) + data;
+        if(slot == N - 1) this->sum = this->lapSum;
+    }
+
+    buffer[slot] = data;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr void ofxStaticDataBuffer_<T, N, Stats>::clear(){
+    head  = 0;
+    count = 0;
+
+    if constexpr (tracks(ofxDataBufferStats::SUM)) {
+        this->sum    = 0.0;
+        this->lapSum = 0.0;
+    }
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr size_t ofxStaticDataBuffer_<T, N, Stats>::getSize() const {
+    return count;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr bool ofxStaticDataBuffer_<T, N, Stats>::isFull() const {
+    return count == N;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr T ofxStaticDataBuffer_<T, N, Stats>::operator[](size_t i) const {
+    return buffer[(head + i) % N];
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr T ofxStaticDataBuffer_<T, N, Stats>::getLast() const {
+    return (*this)[count - 1];
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr T ofxStaticDataBuffer_<T, N, Stats>::getFirst() const {
+    return (*this)[0];
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr T ofxStaticDataBuffer_<T, N, Stats>::getMin() const {
+    return count > 0 ? (*this)[getMinIndex()] : T();
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr T ofxStaticDataBuffer_<T, N, Stats>::getMax() const {
+    return count > 0 ? (*this)[getMaxIndex()] : T();
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr size_t ofxStaticDataBuffer_<T, N, Stats>::getMinIndex() const {
+    static_assert(tracks(ofxDataBufferStats::MIN), "MIN is not in this buffer's statistics.");
+
+    size_t minimumIdx = 0;
+    for(size_t i = 1; i < count; ++i) {
+        if((*this)[i] < (*this)[minimumIdx]) minimumIdx = i;
+    }
+    return minimumIdx;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr size_t ofxStaticDataBuffer_<T, N, Stats>::getMaxIndex() const {
+    static_assert(tracks(ofxDataBufferStats::MAX), "MAX is not in this buffer's statistics.");
+
+    size_t maximumIdx = 0;
+    for(size_t i = 1; i < count; ++i) {
+        if((*this)[i] > (*this)[maximumIdx]) maximumIdx = i;
+    }
+    return maximumIdx;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr double ofxStaticDataBuffer_<T, N, Stats>::getSum() const {
+    static_assert(tracks(ofxDataBufferStats::SUM), "SUM is not in this buffer's statistics.");
+    return this->sum;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr double ofxStaticDataBuffer_<T, N, Stats>::getMean() const {
+    return count > 0 ? getSum() / count : 0.0;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr double ofxStaticDataBuffer_<T, N, Stats>::getVariance() const {
+    return count > 1 ? calcM2() / (count - 1) : 0.0;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr double ofxStaticDataBuffer_<T, N, Stats>::getPopulationVariance() const {
+    return count > 0 ? calcM2() / count : 0.0;
+}
+
+template<typename T, size_t N, unsigned Stats>
+double ofxStaticDataBuffer_<T, N, Stats>::getStdDev() const {
+    return std::sqrt(getVariance());
+}
+
+template<typename T, size_t N, unsigned Stats>
+double ofxStaticDataBuffer_<T, N, Stats>::getPopulationStdDev() const {
+    return std::sqrt(getPopulationVariance());
+}
+
+template<typename T, size_t N, unsigned Stats>
+double ofxStaticDataBuffer_<T, N, Stats>::getMedian() const {
+    static_assert(tracks(ofxDataBufferStats::MEDIAN), "MEDIAN is not in this buffer's statistics.");
+
+    if(count == 0) return 0.0;
+
+    // the copy stays on the stack
+    std::array<T, N> bufferCopy = buffer;
+    size_t n = count / 2;
+
+    // the live samples are the first count slots whenever the buffer isn't full
+    std::nth_element(bufferCopy.begin(), bufferCopy.begin() + n, bufferCopy.begin() + count);
+    double med = bufferCopy[n];
+
+    if(count % 2 != 0) { // odd
+        return med;
+    } else { // even
+        return (med + *std::max_element(bufferCopy.begin(), bufferCopy.begin() + n)) / 2.0;
+    }
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr double ofxStaticDataBuffer_<T, N, Stats>::calcSum() const {
+    double total = 0.0;
+    for(size_t i = 0; i < count; ++i) total += (*this)[i];
+    return total;
+}
+
+template<typename T, size_t N, unsigned Stats>
+constexpr double ofxStaticDataBuffer_<T, N, Stats>::calcM2() const {
+    static_assert(tracks(ofxDataBufferStats::VARIANCE), "VARIANCE is not in this buffer's statistics.");
+
+    double mean = 0.0;
+
+    if constexpr (tracks(ofxDataBufferStats::SUM)) {
+        mean = this->sum / count;
+    } else {
+        mean = calcSum() / count;
+    }
+
+    double M2 = 0.0;
+    for(size_t i = 0; i < count; ++i) {
+        double delta = (*this)[i] - mean;
+        M2 += delta * delta;
+    }
+    return M2;
+}